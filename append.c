@@ -0,0 +1,242 @@
+/*
+ * Append to an existing compressed file
+ * in time proportional to the appended content
+*/
+
+
+#define _DEFAULT_SOURCE
+
+#include <unistd.h>
+#include "append.h"
+
+
+// Append the content of every input file, in order, to the compressed file huff_file_name (created if it does not exist).
+// Returns 0 if successful or the error code of the first file that could not be appended.
+int appendFiles(const char *huff_file_name, char **in_file_names, int num_files, int use_pairs)
+{
+    encoder_context *context = calloc(1, sizeof(encoder_context));  // too big for the stack of some systems
+    FILE *fp_huff_file = NULL;
+    FILE *fp_in_file = NULL;
+    long old_size, new_size;
+    int result = 0;
+
+    if (context == NULL)
+    {
+        printf("Failed to allocate memory for the encoder!\n");
+        return FAIL_ALLOCATE_MEMORY;
+    }
+    context->use_pairs = use_pairs;
+
+    fp_huff_file = fopen(huff_file_name, "r+");
+    if (fp_huff_file == NULL)
+    {
+        fp_huff_file = fopen(huff_file_name, "w+");
+    }
+    if (fp_huff_file == NULL)
+    {
+        printf("Failed to open the compressed file %s!\n", huff_file_name);
+        free(context);
+        return FAIL_OPEN_OUTPUT_FILE;
+    }
+
+    for (int i = 0; i < num_files && result == 0; i++)
+    {
+        fp_in_file = fopen(in_file_names[i], "r");
+        if (fp_in_file == NULL)
+        {
+            printf("Failed to open the input file %s!\n", in_file_names[i]);
+            result = FAIL_OPEN_INPUT_FILE;
+            break;
+        }
+
+        fseek(fp_huff_file, 0, SEEK_END);
+        old_size = ftell(fp_huff_file);
+        result = appendFile(fp_in_file, fp_huff_file, context);
+        fseek(fp_huff_file, 0, SEEK_END);
+        new_size = ftell(fp_huff_file);
+
+        if (result == 0)
+        {
+            printf("Appended %s to %s: %ld bytes -> %ld bytes\n", in_file_names[i], huff_file_name, ftell(fp_in_file), new_size - old_size);
+        }
+        fclose(fp_in_file);
+    }
+
+    if (fclose(fp_huff_file) == EOF && result == 0)
+    {
+        printf("Failed to write the compressed file %s!\n", huff_file_name);
+        result = FAIL_WRITE_BODY;
+    }
+    free(context);
+
+    return result;
+}
+
+
+// Append the content of fp_in_file to the compressed file fp_huff_file (opened for reading and writing) as new blocks followed by an index,
+// without reading the blocks already in it. Returns 0 if successful or one of the error codes in common.h (the compressed file is left as it was).
+int appendFile(FILE *fp_in_file, FILE *fp_huff_file, encoder_context *context)
+{
+    bit_writer writer = {fp_huff_file, 0, 0};
+    char *buffer = malloc(MAX_BLOCK_SIZE);  // The content is appended in blocks of at most MAX_BLOCK_SIZE
+    FILE *fp_block = NULL;
+    size_t block_size;
+    long huff_file_size, index_offset;
+    int result = 0;
+
+    if (buffer == NULL)
+    {
+        printf("Failed to allocate memory for a block!\n");
+        return FAIL_ALLOCATE_MEMORY;
+    }
+
+    if (fseek(fp_huff_file, 0, SEEK_END) != 0 || (huff_file_size = ftell(fp_huff_file)) == -1)
+    {
+        printf("Failed to seek in the compressed file!\n");
+        free(buffer);
+        return FAIL_OPEN_OUTPUT_FILE;
+    }
+
+    context->reuse_codebook = 1;
+    findAppendCodebook(fp_huff_file, huff_file_size, context);
+    fseek(fp_huff_file, huff_file_size, SEEK_SET);
+
+    // Every block refers to the latest tree or carries a new one, which the following blocks can refer to
+    while (result == 0 && (block_size = fread(buffer, 1, MAX_BLOCK_SIZE, fp_in_file)) > 0)
+    {
+        fp_block = fmemopen(buffer, block_size, "r");
+        if (fp_block == NULL)
+        {
+            printf("Failed to allocate memory for a block!\n");
+            result = FAIL_ALLOCATE_MEMORY;
+            break;
+        }
+        result = encodeFile(fp_block, fp_huff_file, context);
+        fclose(fp_block);
+    }
+    if (result == 0 && ferror(fp_in_file))
+    {
+        printf("Failed to read the input file!\n");
+        result = FAIL_OPEN_INPUT_FILE;
+    }
+
+    // A compressed file needs at least one block, a new one with an empty input gets the empty block of an empty file
+    if (result == 0 && huff_file_size == 0 && ftell(fp_huff_file) == 0)
+    {
+        fp_block = fmemopen(buffer, 0, "r");
+        if (fp_block == NULL)
+        {
+            printf("Failed to allocate memory for a block!\n");
+            result = FAIL_ALLOCATE_MEMORY;
+        }
+        else
+        {
+            result = encodeFile(fp_block, fp_huff_file, context);
+            fclose(fp_block);
+        }
+    }
+
+    // The index lets the next append find the latest tree without reading the blocks
+    index_offset = ftell(fp_huff_file);
+    if (result == 0 && index_offset != huff_file_size
+        && writeHeader(&writer, 0, BLOCK_TYPE_INDEX, 0, NULL, NULL, 0,
+                       context->reuse_offset >= 0 ? index_offset - context->reuse_offset : -1) == EOF)
+    {
+        printf("Failed to write the index of the compressed file!\n");
+        result = FAIL_WRITE_HEADER;
+    }
+    if (fflush(fp_huff_file) == EOF && result == 0)
+    {
+        printf("Failed to write the compressed file!\n");
+        result = FAIL_WRITE_BODY;
+    }
+
+    // Cut off the blocks of a failed append, the blocks before them are still a complete compressed file
+    if (result != 0 && ftruncate(fileno(fp_huff_file), huff_file_size) == -1)
+    {
+        printf("Failed to restore the compressed file!\n");
+    }
+
+    context->reuse_codebook = 0;
+    free(buffer);
+    return result;
+}
+
+
+// Find the latest Huffman tree of the compressed file using the index at its end (or its first block if it was never appended to)
+// and store its codes in context. context->reuse_offset is -1 if there is no tree that can be reused.
+void findAppendCodebook(FILE *fp_huff_file, long huff_file_size, encoder_context *context)
+{
+    long decoded_file_size;
+    unsigned char block_type;
+    long codebook_distance;
+
+    context->reuse_offset = -1;
+
+    if (huff_file_size >= INDEX_BLOCK_SIZE && fseek(fp_huff_file, huff_file_size - INDEX_BLOCK_SIZE, SEEK_SET) == 0
+        && fread(&decoded_file_size, sizeof(decoded_file_size), 1, fp_huff_file) == 1
+        && fread(&block_type, sizeof(block_type), 1, fp_huff_file) == 1
+        && fread(&codebook_distance, sizeof(codebook_distance), 1, fp_huff_file) == 1
+        && decoded_file_size == 0 && block_type == BLOCK_TYPE_INDEX)
+    {
+        if (codebook_distance >= 0)
+        {
+            loadAppendCodebook(fp_huff_file, huff_file_size - INDEX_BLOCK_SIZE - codebook_distance, context);
+        }
+        return;
+    }
+
+    // Without an index, the first block is the only one whose header can be found without reading the others
+    loadAppendCodebook(fp_huff_file, 0, context);
+}
+
+
+// Store the codes of the BLOCK_TYPE_HUFFMAN block at offset in context. Returns 0 if successful and -1 if there is no usable tree at offset.
+int loadAppendCodebook(FILE *fp_huff_file, long offset, encoder_context *context)
+{
+    bit_reader reader = {fp_huff_file, 0, 0, NULL, 0, 0};
+    char buf_character_code[MAX_ENCODED_CHARACTER_LENGTH] = {'\0'};
+    long decoded_file_size;
+    unsigned char block_type;
+    unsigned short int tree_size;
+    node *root;
+
+    if (offset < 0 || fseek(fp_huff_file, offset, SEEK_SET) != 0
+        || fread(&decoded_file_size, sizeof(decoded_file_size), 1, fp_huff_file) < 1
+        || fread(&block_type, sizeof(block_type), 1, fp_huff_file) < 1 || block_type != BLOCK_TYPE_HUFFMAN
+        || fread(&tree_size, sizeof(tree_size), 1, fp_huff_file) < 1)
+    {
+        return -1;
+    }
+
+    // The decoder reads the same tree, so any tree that can be encoded with is fine (a leaf would give an empty code)
+    root = ReconstructHuffmanTree(&reader, tree_size, CHAR_BIT);
+    if (root == NULL || root->left == NULL || huffmanTreeDepth(root) >= MAX_ENCODED_CHARACTER_LENGTH)
+    {
+        freeBinaryTree(root);
+        return -1;
+    }
+
+    memset(context->reused_characters_table, 0, sizeof(context->reused_characters_table));
+    populateEncodedCharactersTable(root, 0, buf_character_code, context->reused_characters_table);
+    freeBinaryTree(root);
+    context->reuse_offset = offset;
+
+    return 0;
+}
+
+
+// Returns the length of the longest path from the root to a leaf
+int huffmanTreeDepth(node *root)
+{
+    int left_depth, right_depth;
+
+    if (root == NULL || (root->left == NULL && root->right == NULL))
+    {
+        return 0;
+    }
+    left_depth = huffmanTreeDepth(root->left);
+    right_depth = huffmanTreeDepth(root->right);
+
+    return 1 + (left_depth > right_depth ? left_depth : right_depth);
+}
@@ -0,0 +1,35 @@
+/*
+ * Macros and function declarations
+ * used for appending to an existing compressed file
+*/
+
+
+#ifndef APPEND_H
+#define APPEND_H
+
+#include "encode.h"
+#include "decode.h"
+
+// Size of a BLOCK_TYPE_INDEX block: the size of the content (0), the block type and the distance back to the latest Huffman block
+#define INDEX_BLOCK_SIZE ((long)(sizeof(long) + sizeof(unsigned char) + sizeof(long)))
+
+
+// Append the content of every input file, in order, to the compressed file huff_file_name (created if it does not exist).
+// Returns 0 if successful or the error code of the first file that could not be appended.
+int appendFiles(const char *huff_file_name, char **in_file_names, int num_files, int use_pairs);
+
+// Append the content of fp_in_file to the compressed file fp_huff_file (opened for reading and writing) as new blocks followed by an index,
+// without reading the blocks already in it. Returns 0 if successful or one of the error codes in common.h (the compressed file is left as it was).
+int appendFile(FILE *fp_in_file, FILE *fp_huff_file, encoder_context *context);
+
+// Find the latest Huffman tree of the compressed file using the index at its end (or its first block if it was never appended to)
+// and store its codes in context. context->reuse_offset is -1 if there is no tree that can be reused.
+void findAppendCodebook(FILE *fp_huff_file, long huff_file_size, encoder_context *context);
+
+// Store the codes of the BLOCK_TYPE_HUFFMAN block at offset in context. Returns 0 if successful and -1 if there is no usable tree at offset.
+int loadAppendCodebook(FILE *fp_huff_file, long offset, encoder_context *context);
+
+// Returns the length of the longest path from the root to a leaf
+int huffmanTreeDepth(node *root);
+
+#endif
@@ -0,0 +1,629 @@
+/*
+ * Encode or decode many files and directories in parallel
+ * using the work-stealing scheduler
+*/
+
+
+#define _DEFAULT_SOURCE
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "batch.h"
+
+
+// Initialize an empty batch
+void initBatch(batch *files, int operation)
+{
+    memset(files, 0, sizeof(*files));
+    files->operation = operation;
+    initCodebookCache(&files->encoder_cache);
+    initCodebookCache(&files->decoder_cache);
+}
+
+
+// Free the memory used by a batch
+void freeBatch(batch *files)
+{
+    for (int i = 0; i < files->num_files; i++)
+    {
+        free(files->files[i].in_file_name);
+        free(files->files[i].out_file_name);
+        free(files->files[i].blocks);
+    }
+    free(files->files);
+    free(files->contexts);
+    freeCodebookCache(&files->encoder_cache);
+    freeCodebookCache(&files->decoder_cache);
+    files->files = NULL;
+    files->contexts = NULL;
+    files->num_files = 0;
+}
+
+
+// Add a file or every file in a directory tree. Directories are searched only for files that can be processed
+// (.huff files when decoding, other files when encoding), symbolic links to directories in them are skipped.
+// Returns 0 if successful or one of the error codes in common.h.
+int addBatchPath(batch *files, const char *path, int from_directory)
+{
+    struct stat path_stat;
+    DIR *directory;
+    struct dirent *entry;
+    char *entry_path;
+    size_t path_length = strlen(path);
+    int is_compressed = path_length >= COMPRESSED_FILE_EXTENSION_LENGTH
+                        && strcmp(path + path_length - COMPRESSED_FILE_EXTENSION_LENGTH + 1, COMPRESSED_FILE_EXTENSION) == 0;
+    int result = 0;
+
+    if (stat(path, &path_stat) == -1)
+    {
+        printf("Failed to open %s!\n", path);
+        return FAIL_OPEN_INPUT_FILE;
+    }
+
+    // Symbolic links to directories found in a directory are not followed, a link to a parent directory would never end
+    if (from_directory && S_ISDIR(path_stat.st_mode) && (lstat(path, &path_stat) == -1 || S_ISLNK(path_stat.st_mode)))
+    {
+        return 0;
+    }
+
+    if (S_ISDIR(path_stat.st_mode))
+    {
+        directory = opendir(path);
+        if (directory == NULL)
+        {
+            printf("Failed to open the directory %s!\n", path);
+            return FAIL_OPEN_INPUT_FILE;
+        }
+
+        while (result == 0 && (entry = readdir(directory)) != NULL)
+        {
+            if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+            {
+                continue;
+            }
+
+            entry_path = malloc(path_length + strlen(entry->d_name) + 2);
+            if (entry_path == NULL)
+            {
+                printf("Failed to allocate memory for a file name!\n");
+                result = FAIL_ALLOCATE_MEMORY;
+                break;
+            }
+            sprintf(entry_path, "%s%s%s", path, path[path_length - 1] == '/' ? "" : "/", entry->d_name);
+            result = addBatchPath(files, entry_path, 1);
+            free(entry_path);
+        }
+
+        closedir(directory);
+        return result;
+    }
+
+    if (!S_ISREG(path_stat.st_mode))
+    {
+        if (from_directory)
+        {
+            return 0;
+        }
+        printf("%s is not a regular file!\n", path);
+        return INVALID_FILE_NAME;
+    }
+
+    // Files found in a directory are skipped if they can't be processed, files given explicitly are an error
+    if (files->operation == BATCH_ENCODE && is_compressed && from_directory)
+    {
+        return 0;
+    }
+    if (files->operation == BATCH_DECODE && !is_compressed)
+    {
+        if (from_directory)
+        {
+            return 0;
+        }
+        printf("The input file must have %s extension\n", COMPRESSED_FILE_EXTENSION);
+        return INVALID_FILE_NAME;
+    }
+
+    return addBatchFile(files, path, path_stat.st_size);
+}
+
+
+// Add a file and the name of its output file. Returns 0 if successful or one of the error codes in common.h.
+int addBatchFile(batch *files, const char *in_file_name, long in_file_size)
+{
+    batch_file *new_files;
+    batch_file *file;
+    const char *base_name = strrchr(in_file_name, '/');
+    size_t directory_length = base_name ? (size_t) (base_name - in_file_name + 1) : 0;
+    size_t in_file_name_length = strlen(in_file_name);
+
+    if (files->num_files == files->capacity)
+    {
+        new_files = realloc(files->files, sizeof(batch_file) * (files->capacity ? files->capacity * 2 : 16));
+        if (new_files == NULL)
+        {
+            printf("Failed to allocate memory for a file!\n");
+            return FAIL_ALLOCATE_MEMORY;
+        }
+        files->files = new_files;
+        files->capacity = files->capacity ? files->capacity * 2 : 16;
+    }
+
+    file = &files->files[files->num_files];
+    memset(file, 0, sizeof(*file));
+    file->batch = files;
+    file->in_file_size = in_file_size;
+    file->in_file_name = malloc(in_file_name_length + 1);
+    file->out_file_name = malloc(in_file_name_length + COMPRESSED_FILE_EXTENSION_LENGTH + sizeof(DECODED_FILE_PREFIX));
+    if (file->in_file_name == NULL || file->out_file_name == NULL)
+    {
+        printf("Failed to allocate memory for a file name!\n");
+        free(file->in_file_name);
+        free(file->out_file_name);
+        return FAIL_ALLOCATE_MEMORY;
+    }
+    strcpy(file->in_file_name, in_file_name);
+
+    if (files->operation == BATCH_ENCODE)
+    {
+        // example.txt -> example.txt.huff
+        strcpy(file->out_file_name, in_file_name);
+        strcat(file->out_file_name, COMPRESSED_FILE_EXTENSION);
+    }
+    else
+    {
+        // directory/example.txt.huff -> directory/decoded_example.txt
+        memcpy(file->out_file_name, in_file_name, directory_length);
+        strcpy(file->out_file_name + directory_length, DECODED_FILE_PREFIX);
+        strcat(file->out_file_name, in_file_name + directory_length);
+        file->out_file_name[strlen(file->out_file_name) - COMPRESSED_FILE_EXTENSION_LENGTH + 1] = '\0';
+    }
+
+    files->num_files++;
+
+    return 0;
+}
+
+
+// Encode or decode all files on num_workers threads and print a summary.
+// Returns 0 if every file was successful or the error code of the first file that was not.
+int runBatch(batch *files, int num_workers)
+{
+    struct timespec start, end;
+    int result = 0;
+
+    if (files->operation == BATCH_ENCODE)
+    {
+        // Each worker has its own tables (too big for the stack of some systems), the codebooks are shared
+        files->contexts = calloc(num_workers, sizeof(encoder_context));
+        if (files->contexts == NULL)
+        {
+            printf("Failed to allocate memory for the encoders!\n");
+            return FAIL_ALLOCATE_MEMORY;
+        }
+        for (int i = 0; i < num_workers; i++)
+        {
+            files->contexts[i].cache = &files->encoder_cache;
+            files->contexts[i].use_pairs = files->use_pairs;
+        }
+    }
+
+    if (initScheduler(&files->pool, num_workers) == -1)
+    {
+        return FAIL_ALLOCATE_MEMORY;
+    }
+
+    // The array of files grows while they are added, a mutex must not be moved once it is initialized
+    for (int i = 0; i < files->num_files; i++)
+    {
+        pthread_mutex_init(&files->files[i].mutex, NULL);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (int i = 0; i < files->num_files; i++)
+    {
+        if (submitTask(&files->pool, -1, files->operation == BATCH_ENCODE ? encodeFileTask : decodeFileTask, &files->files[i]) == -1)
+        {
+            files->files[i].status = FAIL_ALLOCATE_MEMORY;
+        }
+    }
+
+    if (runScheduler(&files->pool) == -1)
+    {
+        result = FAIL_ALLOCATE_MEMORY;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    freeScheduler(&files->pool);
+    for (int i = 0; i < files->num_files; i++)
+    {
+        pthread_mutex_destroy(&files->files[i].mutex);
+    }
+    if (result != 0)
+    {
+        return result;
+    }
+
+    for (int i = 0; i < files->num_files; i++)
+    {
+        if (files->files[i].status != 0)
+        {
+            printf("Failed to %s %s!\n", files->operation == BATCH_ENCODE ? "encode" : "decode", files->files[i].in_file_name);
+            if (result == 0)
+            {
+                result = files->files[i].status;
+            }
+        }
+    }
+
+    if (files->num_files == 1 && result == 0)
+    {
+        if (files->operation == BATCH_ENCODE)
+        {
+            printf("\nSuccessfully encoded the file!\n%s is %.2lf%% the size of %s\n", files->files[0].out_file_name,
+                   ((double) files->files[0].out_file_size / files->files[0].in_file_size * 100), files->files[0].in_file_name);
+        }
+        else
+        {
+            printf("\nSuccessfully decoded %s into %s!\n", files->files[0].in_file_name, files->files[0].out_file_name);
+        }
+    }
+    else if (files->num_files > 1)
+    {
+        printBatchSummary(files, (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9, num_workers);
+    }
+
+    return result;
+}
+
+
+// Task encoding a file, or splitting it into blocks if it is larger than MAX_BLOCK_SIZE
+void encodeFileTask(scheduler *pool, int worker_index, void *arg)
+{
+    batch_file *file = arg;
+    encoder_context *context = &file->batch->contexts[worker_index];
+    FILE *fp_in_file = NULL;
+    FILE *fp_out_file = NULL;
+    char *temp_file_name = NULL;
+    int is_last;
+
+    if (file->in_file_size > MAX_BLOCK_SIZE)
+    {
+        file->num_blocks = (file->in_file_size + MAX_BLOCK_SIZE - 1) / MAX_BLOCK_SIZE;
+        file->blocks = calloc(file->num_blocks, sizeof(batch_block));
+        if (file->blocks == NULL)
+        {
+            printf("Failed to allocate memory for the blocks of %s!\n", file->in_file_name);
+            file->status = FAIL_ALLOCATE_MEMORY;
+            return;
+        }
+
+        for (int i = 0; i < file->num_blocks; i++)
+        {
+            file->blocks[i].offset = i * MAX_BLOCK_SIZE;
+            file->blocks[i].size = i == file->num_blocks - 1 ? file->in_file_size - i * MAX_BLOCK_SIZE : MAX_BLOCK_SIZE;
+        }
+
+        // Every block is written as soon as the blocks before it are written
+        file->fp_out_file = openTemporaryFile(file->out_file_name, &file->temp_file_name);
+        if (file->fp_out_file == NULL)
+        {
+            file->status = FAIL_OPEN_OUTPUT_FILE;
+            return;
+        }
+
+        // The tasks go to this worker's deque, idle workers steal them from the other end
+        pthread_mutex_lock(&file->mutex);
+        submitEncodeBlockTasks(pool, worker_index, file);
+        is_last = file->blocks_in_flight == 0;
+        pthread_mutex_unlock(&file->mutex);
+        if (is_last)
+        {
+            // Not even the first task could be submitted
+            file->status = finishTemporaryFile(file->fp_out_file, file->temp_file_name, file->out_file_name, file->status,
+                                               &file->out_file_size);
+        }
+        return;
+    }
+
+    fp_in_file = fopen(file->in_file_name, "r");
+    if (fp_in_file == NULL)
+    {
+        printf("Failed to open the input file %s!\n", file->in_file_name);
+        file->status = FAIL_OPEN_INPUT_FILE;
+        return;
+    }
+
+    fp_out_file = openTemporaryFile(file->out_file_name, &temp_file_name);
+    if (fp_out_file == NULL)
+    {
+        fclose(fp_in_file);
+        file->status = FAIL_OPEN_OUTPUT_FILE;
+        return;
+    }
+
+    file->status = encodeFile(fp_in_file, fp_out_file, context);
+    fclose(fp_in_file);
+
+    if (file->status == 0 && file->batch->print_codes && context->block_type == BLOCK_TYPE_HUFFMAN)
+    {
+        printEncodedCharactersTable(context->encoded_characters_table);
+    }
+    else if (file->status == 0 && file->batch->print_codes && context->block_type == BLOCK_TYPE_PAIRS)
+    {
+        printEncodedPairsTable(context);
+    }
+
+    file->status = finishTemporaryFile(fp_out_file, temp_file_name, file->out_file_name, file->status, &file->out_file_size);
+}
+
+
+// Task encoding the next block of a file that no other task took. The block is written as soon as the blocks before it are written
+// and tasks for the next blocks are submitted. The task of the last encoded block finishes the output file.
+void encodeBlockTask(scheduler *pool, int worker_index, void *arg)
+{
+    batch_file *file = arg;
+    batch_block *block;
+    char *buffer;
+    FILE *fp_in_file = NULL;
+    FILE *fp_block = NULL;
+    FILE *fp_out_file = NULL;
+    int status = 0;
+    int is_last;
+
+    // The blocks are taken in order whichever task runs first, so that few blocks wait for an earlier one to be written
+    pthread_mutex_lock(&file->mutex);
+    block = &file->blocks[file->next_block++];
+    pthread_mutex_unlock(&file->mutex);
+
+    buffer = malloc(block->size);
+    if (buffer == NULL)
+    {
+        printf("Failed to allocate memory for a block of %s!\n", file->in_file_name);
+        status = FAIL_ALLOCATE_MEMORY;
+    }
+    else if ((fp_in_file = fopen(file->in_file_name, "r")) == NULL)
+    {
+        printf("Failed to open the input file %s!\n", file->in_file_name);
+        status = FAIL_OPEN_INPUT_FILE;
+    }
+    else if (fseek(fp_in_file, block->offset, SEEK_SET) != 0
+             || fread(buffer, 1, block->size, fp_in_file) != (size_t) block->size)
+    {
+        printf("Failed to read a block of %s!\n", file->in_file_name);
+        status = FAIL_OPEN_INPUT_FILE;
+    }
+    else if ((fp_block = fmemopen(buffer, block->size, "r")) == NULL
+             || (fp_out_file = open_memstream(&block->output, &block->output_size)) == NULL)
+    {
+        printf("Failed to allocate memory for a block of %s!\n", file->in_file_name);
+        status = FAIL_ALLOCATE_MEMORY;
+    }
+    else
+    {
+        status = encodeFile(fp_block, fp_out_file, &file->batch->contexts[worker_index]);
+    }
+
+    if (fp_in_file)
+    {
+        fclose(fp_in_file);
+    }
+    if (fp_block)
+    {
+        fclose(fp_block);
+    }
+    if (fp_out_file)
+    {
+        fclose(fp_out_file);
+    }
+    free(buffer);
+
+    pthread_mutex_lock(&file->mutex);
+    if (status != 0 && file->status == 0)
+    {
+        file->status = status;
+    }
+    block->is_encoded = 1;
+    if (file->status == 0)
+    {
+        file->status = writeEncodedBlocks(file);
+    }
+    file->blocks_in_flight--;
+    submitEncodeBlockTasks(pool, worker_index, file);
+    is_last = file->blocks_in_flight == 0;
+    pthread_mutex_unlock(&file->mutex);
+
+    if (is_last)
+    {
+        // Blocks that were not written because of an error
+        for (int i = 0; i < file->num_blocks; i++)
+        {
+            free(file->blocks[i].output);
+            file->blocks[i].output = NULL;
+        }
+        file->status = finishTemporaryFile(file->fp_out_file, file->temp_file_name, file->out_file_name, file->status,
+                                           &file->out_file_size);
+        file->fp_out_file = NULL;
+        file->temp_file_name = NULL;
+    }
+}
+
+
+// Task decoding a file
+void decodeFileTask(scheduler *pool, int worker_index, void *arg)
+{
+    batch_file *file = arg;
+    FILE *fp_in_file = NULL;
+    FILE *fp_out_file = NULL;
+    char *temp_file_name = NULL;
+
+    (void) pool;
+    (void) worker_index;
+
+    fp_in_file = fopen(file->in_file_name, "r");
+    if (fp_in_file == NULL)
+    {
+        printf("Failed to open the input file %s!\n", file->in_file_name);
+        file->status = FAIL_OPEN_INPUT_FILE;
+        return;
+    }
+
+    fp_out_file = openTemporaryFile(file->out_file_name, &temp_file_name);
+    if (fp_out_file == NULL)
+    {
+        fclose(fp_in_file);
+        file->status = FAIL_OPEN_OUTPUT_FILE;
+        return;
+    }
+
+    file->status = decodeFile(fp_in_file, fp_out_file, &file->batch->decoder_cache, -1);
+    fclose(fp_in_file);
+
+    file->status = finishTemporaryFile(fp_out_file, temp_file_name, file->out_file_name, file->status, &file->out_file_size);
+}
+
+
+// Submit tasks for the next blocks of a file while less than BLOCKS_IN_FLIGHT_PER_WORKER blocks for every worker are submitted
+// and not written yet, so that the blocks waiting for an earlier one don't keep the whole file in memory.
+// Called with file->mutex locked. Sets file->status if a task could not be submitted.
+void submitEncodeBlockTasks(scheduler *pool, int worker_index, batch_file *file)
+{
+    while (file->status == 0 && file->submitted_blocks < file->num_blocks
+           && file->submitted_blocks - file->next_written_block < BLOCKS_IN_FLIGHT_PER_WORKER * pool->num_workers)
+    {
+        if (submitTask(pool, worker_index, encodeBlockTask, file) == -1)
+        {
+            printf("Failed to allocate memory for a block of %s!\n", file->in_file_name);
+            file->status = FAIL_ALLOCATE_MEMORY;
+            return;
+        }
+        file->submitted_blocks++;
+        file->blocks_in_flight++;
+    }
+}
+
+
+// Write the encoded blocks that follow the ones already written, in order, into the output file and free them.
+// Called with file->mutex locked. Returns 0 if successful or FAIL_WRITE_BODY.
+int writeEncodedBlocks(batch_file *file)
+{
+    batch_block *block;
+
+    while (file->next_written_block < file->num_blocks && file->blocks[file->next_written_block].is_encoded)
+    {
+        block = &file->blocks[file->next_written_block++];
+        if (fwrite(block->output, 1, block->output_size, file->fp_out_file) != block->output_size)
+        {
+            printf("Failed to write the output file %s!\n", file->out_file_name);
+            return FAIL_WRITE_BODY;
+        }
+        free(block->output);
+        block->output = NULL;
+    }
+
+    return 0;
+}
+
+
+// Create a temporary file next to out_file_name. Returns the opened file or NULL if unsuccessful.
+FILE *openTemporaryFile(const char *out_file_name, char **p_temp_file_name)
+{
+    FILE *fp_out_file;
+    int fd;
+
+    *p_temp_file_name = malloc(strlen(out_file_name) + sizeof(TEMPORARY_FILE_SUFFIX));
+    if (*p_temp_file_name == NULL)
+    {
+        printf("Failed to allocate memory for a file name!\n");
+        return NULL;
+    }
+    strcpy(*p_temp_file_name, out_file_name);
+    strcat(*p_temp_file_name, TEMPORARY_FILE_SUFFIX);
+
+    // In the same directory, so that renaming it replaces the output file at once
+    fd = mkstemp(*p_temp_file_name);
+    if (fd == -1 || (fp_out_file = fdopen(fd, "w")) == NULL)
+    {
+        printf("Failed to open the output file %s!\n", out_file_name);
+        if (fd != -1)
+        {
+            close(fd);
+            unlink(*p_temp_file_name);
+        }
+        free(*p_temp_file_name);
+        *p_temp_file_name = NULL;
+        return NULL;
+    }
+
+    // mkstemp() creates the file readable only by its owner
+    fchmod(fd, 0644);
+
+    return fp_out_file;
+}
+
+
+// Close the temporary file and rename it to out_file_name if status is 0, otherwise remove it. Returns status or the error code of closing/renaming.
+int finishTemporaryFile(FILE *fp_out_file, char *temp_file_name, const char *out_file_name, int status, long *out_file_size)
+{
+    if (status == 0)
+    {
+        fseek(fp_out_file, 0, SEEK_END);
+        *out_file_size = ftell(fp_out_file);
+    }
+
+    if (fclose(fp_out_file) == EOF && status == 0)
+    {
+        printf("Failed to write the output file %s!\n", out_file_name);
+        status = FAIL_WRITE_BODY;
+    }
+
+    if (status == 0 && rename(temp_file_name, out_file_name) == -1)
+    {
+        printf("Failed to rename the output file %s!\n", out_file_name);
+        status = FAIL_OPEN_OUTPUT_FILE;
+    }
+
+    if (status != 0)
+    {
+        unlink(temp_file_name);
+    }
+    free(temp_file_name);
+
+    return status;
+}
+
+
+// Print the number of files, the total sizes, the ratio, the throughput and the codebook cache hits and misses
+void printBatchSummary(batch *files, double seconds, int num_workers)
+{
+    codebook_cache *cache = files->operation == BATCH_ENCODE ? &files->encoder_cache : &files->decoder_cache;
+    long in_size = 0;
+    long out_size = 0;
+    long compressed_size, original_size;
+    int num_failed = 0;
+
+    for (int i = 0; i < files->num_files; i++)
+    {
+        if (files->files[i].status != 0)
+        {
+            num_failed++;
+            continue;
+        }
+        in_size += files->files[i].in_file_size;
+        out_size += files->files[i].out_file_size;
+    }
+
+    compressed_size = files->operation == BATCH_ENCODE ? out_size : in_size;
+    original_size = files->operation == BATCH_ENCODE ? in_size : out_size;
+
+    printf("\n%s %d of %d files on %d threads in %.3lf s\n", files->operation == BATCH_ENCODE ? "Encoded" : "Decoded",
+           files->num_files - num_failed, files->num_files, num_workers, seconds);
+    printf("%ld bytes -> %ld bytes, compressed size is %.2lf%% of the original\n", in_size, out_size,
+           original_size ? (double) compressed_size / original_size * 100 : 100.0);
+    printf("Throughput: %.2lf MB/s of %s data, %lu tasks stolen\n", seconds > 0 ? original_size / seconds / 1e6 : 0.0,
+           files->operation == BATCH_ENCODE ? "input" : "decoded", files->pool.steals);
+    // The workers are stopped, so the counters do not change any more
+    printf("Codebook cache: %lu hits, %lu misses\n", cache->hits, cache->misses);
+}
@@ -0,0 +1,116 @@
+/*
+ * Data structures, macros and function declarations
+ * used for encoding or decoding many files and directories in parallel
+*/
+
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "encode.h"
+#include "decode.h"
+#include "codebook_cache.h"
+#include "scheduler.h"
+
+#define DECODED_FILE_PREFIX "decoded_"  // the prefix of the name of a decoded file
+#define TEMPORARY_FILE_SUFFIX ".XXXXXX"  // the output is written to a temporary file that gets renamed when it is complete
+#define BLOCKS_IN_FLIGHT_PER_WORKER 2  // blocks of a file submitted and not written yet for every worker, bounds the encoded blocks kept in memory
+
+// What a batch does with its files
+#define BATCH_ENCODE 0
+#define BATCH_DECODE 1
+
+
+// A block of a file larger than MAX_BLOCK_SIZE, encoded by its own task
+typedef struct batch_block
+{
+    long offset;  // where the block starts in the input file
+    long size;
+    char *output;  // the encoded block, kept in memory until the blocks before it are written
+    size_t output_size;
+    int is_encoded;
+} batch_block;
+
+// A file encoded or decoded by a batch
+typedef struct batch_file
+{
+    struct batch *batch;
+    char *in_file_name;
+    char *out_file_name;
+    long in_file_size;
+    long out_file_size;
+    int status;  // 0 if successful or one of the error codes in common.h
+    batch_block *blocks;  // NULL if the whole file is encoded by a single task
+    int num_blocks;
+    int submitted_blocks;  // blocks that tasks were submitted for
+    int next_block;  // the next block to encode, taken by the next task that runs
+    int next_written_block;  // the next block to write into the output file
+    int blocks_in_flight;  // tasks submitted and not finished yet, the last one finishes the output file
+    FILE *fp_out_file;  // the temporary output file the blocks are written into
+    char *temp_file_name;
+    pthread_mutex_t mutex;  // initialized only while runBatch() runs, the array of files moves while it grows
+} batch_file;
+
+// Files encoded or decoded by a pool of workers
+typedef struct batch
+{
+    int operation;  // BATCH_ENCODE or BATCH_DECODE
+    batch_file *files;
+    int num_files;
+    int capacity;
+    int print_codes;  // print the Huffman codes of a file encoded as a single Huffman block (when there is only one file)
+    int use_pairs;  // also try coding frequent pairs of characters as single symbols (BLOCK_TYPE_PAIRS)
+    encoder_context *contexts;  // one for every worker, reused for all files and blocks that the worker encodes
+    codebook_cache encoder_cache;  // codebooks shared by all files of the batch
+    codebook_cache decoder_cache;
+    scheduler pool;
+} batch;
+
+
+// Initialize an empty batch
+void initBatch(batch *files, int operation);
+
+// Free the memory used by a batch
+void freeBatch(batch *files);
+
+// Add a file or every file in a directory tree. Directories are searched only for files that can be processed
+// (.huff files when decoding, other files when encoding), symbolic links to directories in them are skipped.
+// Returns 0 if successful or one of the error codes in common.h.
+int addBatchPath(batch *files, const char *path, int from_directory);
+
+// Add a file and the name of its output file. Returns 0 if successful or one of the error codes in common.h.
+int addBatchFile(batch *files, const char *in_file_name, long in_file_size);
+
+// Encode or decode all files on num_workers threads and print a summary.
+// Returns 0 if every file was successful or the error code of the first file that was not.
+int runBatch(batch *files, int num_workers);
+
+// Task encoding a file, or splitting it into blocks if it is larger than MAX_BLOCK_SIZE
+void encodeFileTask(scheduler *pool, int worker_index, void *arg);
+
+// Task encoding the next block of a file that no other task took. The block is written as soon as the blocks before it are written
+// and tasks for the next blocks are submitted. The task of the last encoded block finishes the output file.
+void encodeBlockTask(scheduler *pool, int worker_index, void *arg);
+
+// Submit tasks for the next blocks of a file while less than BLOCKS_IN_FLIGHT_PER_WORKER blocks for every worker are submitted
+// and not written yet, so that the blocks waiting for an earlier one don't keep the whole file in memory.
+// Called with file->mutex locked. Sets file->status if a task could not be submitted.
+void submitEncodeBlockTasks(scheduler *pool, int worker_index, batch_file *file);
+
+// Task decoding a file
+void decodeFileTask(scheduler *pool, int worker_index, void *arg);
+
+// Write the encoded blocks that follow the ones already written, in order, into the output file and free them.
+// Called with file->mutex locked. Returns 0 if successful or FAIL_WRITE_BODY.
+int writeEncodedBlocks(batch_file *file);
+
+// Create a temporary file next to out_file_name. Returns the opened file or NULL if unsuccessful.
+FILE *openTemporaryFile(const char *out_file_name, char **p_temp_file_name);
+
+// Close the temporary file and rename it to out_file_name if status is 0, otherwise remove it. Returns status or the error code of closing/renaming.
+int finishTemporaryFile(FILE *fp_out_file, char *temp_file_name, const char *out_file_name, int status, long *out_file_size);
+
+// Print the number of files, the total sizes, the ratio, the throughput and the codebook cache hits and misses
+void printBatchSummary(batch *files, double seconds, int num_workers);
+
+#endif
@@ -0,0 +1,88 @@
+#!/bin/sh
+#
+# Encode and decode a corpus of text, logs and binary data and print how long it took.
+# Used to compare builds and as the training run of `make pgo`.
+# Usage: ./benchmark.sh [directory with encode and decode] [number of rounds]
+
+set -e
+
+BIN_DIR=$(cd "${1:-.}" && pwd)
+ROUNDS=${2:-3}
+SRC_DIR=$(cd "$(dirname "$0")" && pwd)
+CORPUS=$(mktemp -d)
+trap 'rm -rf "$CORPUS"' EXIT
+
+# Text: the sources and the README, repeated to about 4 MB
+for i in $(seq 1 40)
+do
+    cat "$SRC_DIR"/*.c "$SRC_DIR"/*.h "$SRC_DIR"/README.md
+done | head -c 4000000 > "$CORPUS/text.txt"
+
+# Logs: about 4 MB of lines with timestamps, levels, ids and latencies
+awk 'BEGIN {
+    srand(1)
+    split("INFO INFO INFO INFO DEBUG WARN ERROR", levels, " ")
+    split("GET POST PUT DELETE", methods, " ")
+    split("/api/users /api/orders /api/items /health /login /static/app.js", paths, " ")
+    for (i = 0; i < 45000; i++)
+    {
+        printf "2024-03-%02d %02d:%02d:%02d.%03d [%s] worker-%d request_id=%08x %s %s status=%d latency_ms=%d\n",
+               1 + i / 2000 % 28, i / 3600 % 24, i / 60 % 60, i % 60, int(rand() * 1000), levels[1 + int(rand() * 7)],
+               int(rand() * 16), int(rand() * 2147483647), methods[1 + int(rand() * 4)], paths[1 + int(rand() * 6)],
+               rand() < 0.95 ? 200 : 500, int(rand() * rand() * 2000)
+    }
+}' > "$CORPUS/server.log"
+
+# Binary: already compressed images and executables of the system (the same for every build that is compared)
+cat "$SRC_DIR"/explanation/*.png > "$CORPUS/images.bin"
+cat /bin/sh /bin/ls > "$CORPUS/programs.bin"
+
+mkdir "$CORPUS/pairs"
+cp "$CORPUS/text.txt" "$CORPUS/server.log" "$CORPUS/pairs"
+
+# Chunks (not timed): the stream decoder must resume wherever a chunk ends, even in the middle of a header, a tree or a code.
+# A small file with every block type is fed a byte at a time and in odd-sized chunks, and a stream is encoded from odd-sized chunks.
+mkdir "$CORPUS/chunks"
+head -c 60000 "$CORPUS/text.txt" > "$CORPUS/chunks/pairs.txt"
+head -c 60000 "$CORPUS/server.log" > "$CORPUS/chunks/first.log"
+cp "$CORPUS/chunks/first.log" "$CORPUS/chunks/again.log"  # the same characters refer back to the tree of first.log
+head -c 20000 "$CORPUS/images.bin" > "$CORPUS/chunks/raw.bin"
+head -c 5000 /dev/zero > "$CORPUS/chunks/run.bin"
+cd "$CORPUS/chunks"
+"$BIN_DIR/encode" -a all.huff -p pairs.txt > /dev/null
+"$BIN_DIR/encode" -a all.huff first.log again.log raw.bin run.bin > /dev/null
+cat pairs.txt first.log again.log raw.bin run.bin > all.expected
+for size in 1 7 4093
+do
+    dd if=all.huff bs=$size 2> /dev/null | "$BIN_DIR/decode" -s | cmp -s - all.expected || { echo "chunks of $size bytes were not decoded correctly"; exit 1; }
+done
+dd if=first.log bs=13 2> /dev/null | "$BIN_DIR/encode" -s | dd bs=1 2> /dev/null | "$BIN_DIR/decode" -s | cmp -s - first.log \
+    || { echo "chunks of 13 bytes were not encoded correctly"; exit 1; }
+cd - > /dev/null
+rm -rf "$CORPUS/chunks"  # not part of the timed corpus
+
+start=$(date +%s.%N)
+for round in $(seq 1 "$ROUNDS")
+do
+    rm -f "$CORPUS"/*.huff "$CORPUS"/decoded_* "$CORPUS"/pairs/*.huff "$CORPUS"/pairs/decoded_*
+
+    # Files, blocks and pairs with a single thread so that the time is not spread over the processors
+    "$BIN_DIR/encode" -j 1 "$CORPUS/text.txt" "$CORPUS/server.log" "$CORPUS/images.bin" "$CORPUS/programs.bin" > /dev/null
+    "$BIN_DIR/encode" -j 1 -p "$CORPUS/pairs" > /dev/null
+    "$BIN_DIR/decode" -j 1 "$CORPUS" > /dev/null
+
+    # Streaming and appending
+    "$BIN_DIR/encode" -s < "$CORPUS/server.log" > "$CORPUS/stream.huff"
+    "$BIN_DIR/decode" -s < "$CORPUS/stream.huff" > "$CORPUS/stream.out"
+    "$BIN_DIR/encode" -a "$CORPUS/append.huff" "$CORPUS/server.log" "$CORPUS/text.txt" > /dev/null
+
+    for file in text.txt server.log images.bin programs.bin pairs/text.txt pairs/server.log
+    do
+        cmp -s "$CORPUS/$file" "$(dirname "$CORPUS/$file")/decoded_$(basename "$file")" || { echo "$file was not decoded correctly"; exit 1; }
+    done
+    cmp -s "$CORPUS/server.log" "$CORPUS/stream.out" || { echo "server.log was not streamed correctly"; exit 1; }
+done
+end=$(date +%s.%N)
+
+awk -v start="$start" -v end="$end" -v rounds="$ROUNDS" -v bin="$BIN_DIR" \
+    'BEGIN { printf "%s: %.3f s per round (%d rounds)\n", bin, (end - start) / rounds, rounds }'
@@ -0,0 +1,102 @@
+#!/bin/sh
+#
+# Feed malformed and edge-case inputs to encode, decode, huffd and huffc and check that they fail cleanly.
+# Usage: ./check.sh [directory with encode, decode, huffd and huffc]
+
+set -e
+
+BIN_DIR=$(cd "${1:-.}" && pwd)
+WORK_DIR=$(mktemp -d)
+SOCKET="$WORK_DIR/huffd.sock"
+trap 'kill "$HUFFD_PID" 2> /dev/null; rm -rf "$WORK_DIR"' EXIT
+
+fail()
+{
+    echo "FAILED: $1"
+    exit 1
+}
+
+"$BIN_DIR/huffd" -s "$SOCKET" -w 2 -m 1000000 > "$WORK_DIR/huffd.log" 2>&1 &
+HUFFD_PID=$!
+while [ ! -S "$SOCKET" ]
+do
+    sleep 0.1
+done
+
+# A BLOCK_TYPE_RUN header of 10 bytes claiming 700 MiB of 'a' must fail before anything is decoded
+printf '\000\000\300\053\000\000\000\000\002a' > "$WORK_DIR/huge_run.huff"
+status=0
+"$BIN_DIR/huffc" -s "$SOCKET" decode < "$WORK_DIR/huge_run.huff" > "$WORK_DIR/huge_run.out" || status=$?
+[ "$status" -eq 11 ] || fail "a decoded size larger than -m was not refused (status $status)"
+hwm=$(awk '/VmHWM/ { print $2 }' "/proc/$HUFFD_PID/status")
+[ "$hwm" -lt 100000 ] || fail "huffd used $hwm kB of memory for a refused request"
+"$BIN_DIR/huffc" -s "$SOCKET" stats > /dev/null || fail "huffd stopped serving after a refused request"
+
+# Malformed trees: a parent with a single child and leaves left without a parent
+printf '\005\000\000\000\000\000\000\000\000\003\000\260\200\000\000' > "$WORK_DIR/one_child.huff"
+printf '\005\000\000\000\000\000\000\000\000\003\000\260\254\026\000\000' > "$WORK_DIR/no_parent.huff"
+for file in one_child no_parent
+do
+    status=0
+    "$BIN_DIR/huffc" -s "$SOCKET" decode < "$WORK_DIR/$file.huff" > /dev/null || status=$?
+    [ "$status" -eq 3 ] || fail "huffd did not refuse the tree of $file.huff (status $status)"
+done
+
+# Appending an empty file to a new compressed file must still make a valid one, appending it to an existing one must change nothing
+: > "$WORK_DIR/empty.txt"
+printf 'some text to append to\n' > "$WORK_DIR/text.txt"
+"$BIN_DIR/encode" -a "$WORK_DIR/new.huff" "$WORK_DIR/empty.txt" > /dev/null || fail "encode -a refused an empty file for a new compressed file"
+"$BIN_DIR/decode" -s < "$WORK_DIR/new.huff" > "$WORK_DIR/new.out" || fail "an empty file appended to a new compressed file did not decode"
+[ ! -s "$WORK_DIR/new.out" ] || fail "an empty file appended to a new compressed file decoded into characters"
+"$BIN_DIR/encode" -a "$WORK_DIR/existing.huff" "$WORK_DIR/text.txt" > /dev/null
+cp "$WORK_DIR/existing.huff" "$WORK_DIR/existing.before"
+"$BIN_DIR/encode" -a "$WORK_DIR/existing.huff" "$WORK_DIR/empty.txt" > /dev/null || fail "encode -a refused an empty file for an existing compressed file"
+cmp -s "$WORK_DIR/existing.huff" "$WORK_DIR/existing.before" || fail "appending an empty file changed the compressed file"
+"$BIN_DIR/decode" -s < "$WORK_DIR/existing.huff" | cmp -s - "$WORK_DIR/text.txt" || fail "appending an empty file broke the compressed file"
+
+# The stream decoder keeps only the latest trees, an append after more than that many trees must still decode
+for i in $(seq 1 70)
+do
+    awk -v i="$i" 'BEGIN { a = sprintf("%c", 40 + i); b = sprintf("%c", 41 + i); for (k = 0; k < 50; k++) printf "%s%s%s", a, b, b }' > "$WORK_DIR/part.txt"
+    "$BIN_DIR/encode" -a "$WORK_DIR/parts.huff" "$WORK_DIR/part.txt" > /dev/null
+    cat "$WORK_DIR/part.txt" >> "$WORK_DIR/parts.txt"
+done
+"$BIN_DIR/encode" -a "$WORK_DIR/parts.huff" "$WORK_DIR/part.txt" > /dev/null
+cat "$WORK_DIR/part.txt" >> "$WORK_DIR/parts.txt"
+"$BIN_DIR/decode" -s < "$WORK_DIR/parts.huff" | cmp -s - "$WORK_DIR/parts.txt" || fail "a reused tree after many appends was not decoded by decode -s"
+
+# Errors of decode -s go to stderr, stdout only gets the characters decoded before the input was cut off
+for i in $(seq 1 20)
+do
+    cat "$0"
+done | head -c 20000 > "$WORK_DIR/stream.txt"
+"$BIN_DIR/encode" -s < "$WORK_DIR/stream.txt" | head -c 3000 > "$WORK_DIR/cut.huff"
+status=0
+"$BIN_DIR/decode" -s < "$WORK_DIR/cut.huff" > "$WORK_DIR/cut.out" 2> "$WORK_DIR/cut.err" || status=$?
+[ "$status" -ne 0 ] && [ -s "$WORK_DIR/cut.err" ] || fail "decode -s did not report a cut off input on stderr"
+cmp "$WORK_DIR/cut.out" "$WORK_DIR/stream.txt" 2>&1 | grep -q "EOF on" || fail "decode -s wrote something else than the decoded characters to stdout"
+
+# Descriptors passed with a request are installed in huffd whatever the request says, all but the two expected ones must be closed
+if command -v python3 > /dev/null
+then
+    fds_before=$(ls "/proc/$HUFFD_PID/fd" | wc -l)
+    python3 - "$SOCKET" << 'PYTHON'
+import os, socket, struct, sys
+for with_fds, num_fds in [(1, 1), (1, 3), (0, 2), (0, 1), (1, 20)] * 4:
+    client = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+    client.connect(sys.argv[1])
+    fds = [os.open("/dev/null", os.O_RDONLY) for _ in range(num_fds)]
+    socket.send_fds(client, [struct.pack("cc6xq", b"e", bytes([with_fds]), 0)], fds)
+    for fd in fds:
+        os.close(fd)
+    client.recv(16)
+    client.close()
+PYTHON
+    sleep 0.5
+    fds_after=$(ls "/proc/$HUFFD_PID/fd" | wc -l)
+    [ "$fds_after" -le "$fds_before" ] || fail "huffd kept passed descriptors open ($fds_before before, $fds_after after)"
+else
+    echo "Skipped the passed descriptors check, python3 is not installed"
+fi
+
+echo "All checks passed"
@@ -0,0 +1,524 @@
+/*
+ * Cache of built Huffman trees (codebooks),
+ * used both in encode and decode when many files are processed by the same process
+*/
+
+
+#include <math.h>
+#include "codebook_cache.h"
+
+#define FNV_OFFSET_BASIS 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+
+
+// Initialize an empty cache
+void initCodebookCache(codebook_cache *cache)
+{
+    memset(cache->entries, 0, sizeof(cache->entries));
+    cache->clock = 0;
+    cache->hits = 0;
+    cache->misses = 0;
+    pthread_mutex_init(&cache->mutex, NULL);
+}
+
+
+// Free all codebooks in the cache that are not used any more
+void freeCodebookCache(codebook_cache *cache)
+{
+    pthread_mutex_lock(&cache->mutex);
+    for (int i = 0; i < CODEBOOK_CACHE_CAPACITY; i++)
+    {
+        if (cache->entries[i] && --cache->entries[i]->references == 0)
+        {
+            freeCodebook(cache->entries[i]);
+        }
+        cache->entries[i] = NULL;
+    }
+    pthread_mutex_unlock(&cache->mutex);
+}
+
+
+// Find a codebook built for a similar frequency table that can encode every character in frequency_table without a significant penalty.
+// Returns the codebook, which must be released with releaseCodebook(), or NULL if there is none.
+codebook *findEncoderCodebook(codebook_cache *cache, int *frequency_table)
+{
+    uint64_t key = fingerprintFrequencyTable(frequency_table);
+    double entropy = entropyInBits(frequency_table);
+    double encoded_size;
+    codebook *book;
+
+    pthread_mutex_lock(&cache->mutex);
+    cache->clock++;
+    for (int i = 0; i < CODEBOOK_CACHE_CAPACITY; i++)
+    {
+        book = cache->entries[i];
+        if (book == NULL || book->encoded_characters_table == NULL || book->key != key || entropy <= 0)
+        {
+            continue;
+        }
+
+        // Similar fingerprints don't guarantee that every character has a code or that the codes fit the file well enough
+        encoded_size = encodedSizeInBits(frequency_table, book->encoded_characters_table);
+        if (encoded_size >= 0 && encoded_size / entropy <= book->efficiency * (1 + CODEBOOK_CACHE_MAX_PENALTY))
+        {
+            book->last_used = cache->clock;
+            book->references++;
+            cache->hits++;
+            pthread_mutex_unlock(&cache->mutex);
+            return book;
+        }
+    }
+    cache->misses++;
+    pthread_mutex_unlock(&cache->mutex);
+
+    return NULL;
+}
+
+
+// Add a codebook built for frequency_table. The cache takes ownership of root if successful.
+// Returns the codebook, which must be released with releaseCodebook(), or NULL if unsuccessful.
+codebook *addEncoderCodebook(codebook_cache *cache, int *frequency_table, node *root, unsigned short int tree_size,
+                             char encoded_characters_table[NUM_ASCII][MAX_ENCODED_CHARACTER_LENGTH])
+{
+    codebook *book = calloc(1, sizeof(codebook));
+    double entropy = entropyInBits(frequency_table);
+
+    if (book == NULL || entropy <= 0)
+    {
+        free(book);
+        return NULL;
+    }
+
+    book->encoded_characters_table = malloc(NUM_ASCII * sizeof(*book->encoded_characters_table));
+    if (book->encoded_characters_table == NULL)
+    {
+        free(book);
+        return NULL;
+    }
+    memcpy(book->encoded_characters_table, encoded_characters_table, NUM_ASCII * sizeof(*book->encoded_characters_table));
+
+    book->key = fingerprintFrequencyTable(frequency_table);
+    book->efficiency = encodedSizeInBits(frequency_table, encoded_characters_table) / entropy;
+    book->root = root;
+    book->tree_size = tree_size;
+    book->references = 2;  // one for the cache and one for the caller
+
+    pthread_mutex_lock(&cache->mutex);
+    insertCodebook(cache, book);
+    pthread_mutex_unlock(&cache->mutex);
+
+    return book;
+}
+
+
+// Find the tree reconstructed from the same serialized tree. Returns the codebook, which must be released with releaseCodebook(), or NULL if there is none.
+codebook *findDecoderCodebook(codebook_cache *cache, const unsigned char *serialized_tree, size_t serialized_tree_size)
+{
+    uint64_t key = hashBytes(serialized_tree, serialized_tree_size);
+    codebook *book;
+
+    pthread_mutex_lock(&cache->mutex);
+    cache->clock++;
+    for (int i = 0; i < CODEBOOK_CACHE_CAPACITY; i++)
+    {
+        book = cache->entries[i];
+        // Compare the whole serialized tree, a hash collision must not decode a file with the wrong tree
+        if (book && book->serialized_tree && book->key == key && book->serialized_tree_size == serialized_tree_size
+            && memcmp(book->serialized_tree, serialized_tree, serialized_tree_size) == 0)
+        {
+            book->last_used = cache->clock;
+            book->references++;
+            cache->hits++;
+            pthread_mutex_unlock(&cache->mutex);
+            return book;
+        }
+    }
+    cache->misses++;
+    pthread_mutex_unlock(&cache->mutex);
+
+    return NULL;
+}
+
+
+// Add a tree reconstructed from serialized_tree. The cache takes ownership of root if successful.
+// Returns the codebook, which must be released with releaseCodebook(), or NULL if unsuccessful.
+codebook *addDecoderCodebook(codebook_cache *cache, const unsigned char *serialized_tree, size_t serialized_tree_size,
+                             node *root, unsigned short int tree_size)
+{
+    codebook *book = calloc(1, sizeof(codebook));
+
+    if (book == NULL)
+    {
+        return NULL;
+    }
+
+    book->serialized_tree = malloc(serialized_tree_size);
+    if (book->serialized_tree == NULL)
+    {
+        free(book);
+        return NULL;
+    }
+    memcpy(book->serialized_tree, serialized_tree, serialized_tree_size);
+
+    book->key = hashBytes(serialized_tree, serialized_tree_size);
+    book->serialized_tree_size = serialized_tree_size;
+    book->root = root;
+    book->tree_size = tree_size;
+    book->references = 2;  // one for the cache and one for the caller
+
+    pthread_mutex_lock(&cache->mutex);
+    insertCodebook(cache, book);
+    pthread_mutex_unlock(&cache->mutex);
+
+    return book;
+}
+
+
+// Give up a reference to a codebook returned by the functions above
+void releaseCodebook(codebook_cache *cache, codebook *book)
+{
+    pthread_mutex_lock(&cache->mutex);
+    if (--book->references == 0)
+    {
+        freeCodebook(book);
+    }
+    pthread_mutex_unlock(&cache->mutex);
+}
+
+
+// Put a codebook into the cache, evicting the least recently used one (or one with the same key) if needed. The mutex must be locked.
+void insertCodebook(codebook_cache *cache, codebook *book)
+{
+    int slot = -1;
+
+    for (int i = 0; i < CODEBOOK_CACHE_CAPACITY; i++)
+    {
+        // Another thread may have added a codebook for the same key in the meantime, keep only the newest one
+        if (cache->entries[i] && cache->entries[i]->key == book->key)
+        {
+            slot = i;
+            break;
+        }
+        if (slot == -1 || cache->entries[i] == NULL
+            || (cache->entries[slot] && cache->entries[i]->last_used < cache->entries[slot]->last_used))
+        {
+            slot = i;
+        }
+    }
+
+    if (cache->entries[slot] && --cache->entries[slot]->references == 0)
+    {
+        freeCodebook(cache->entries[slot]);
+    }
+
+    book->last_used = ++cache->clock;
+    cache->entries[slot] = book;
+}
+
+
+// Free a codebook and its tree. Used when the last reference is released.
+void freeCodebook(codebook *book)
+{
+    freeBinaryTree(book->root);
+    free(book->encoded_characters_table);
+    free(book->serialized_tree);
+    free(book);
+}
+
+
+// Save the encoder codebooks in a file. Returns 0 if successful and -1 if unsuccessful.
+int saveCodebookCache(codebook_cache *cache, const char *file_name)
+{
+    FILE *fp_out_file = fopen(file_name, "w");
+    codebook *book;
+    int result = 0;
+    unsigned char code_length;
+
+    if (fp_out_file == NULL)
+    {
+        return -1;
+    }
+
+    // For every codebook: the key, the efficiency and every character's code preceded by its length
+    pthread_mutex_lock(&cache->mutex);
+    for (int i = 0; i < CODEBOOK_CACHE_CAPACITY && result == 0; i++)
+    {
+        book = cache->entries[i];
+        if (book == NULL || book->encoded_characters_table == NULL)
+        {
+            continue;
+        }
+
+        if (fwrite(&book->key, sizeof(book->key), 1, fp_out_file) != 1
+            || fwrite(&book->efficiency, sizeof(book->efficiency), 1, fp_out_file) != 1)
+        {
+            result = -1;
+        }
+        for (int character = 0; character < NUM_ASCII && result == 0; character++)
+        {
+            code_length = strlen(book->encoded_characters_table[character]);
+            if (fputc(code_length, fp_out_file) == EOF
+                || fwrite(book->encoded_characters_table[character], 1, code_length, fp_out_file) != code_length)
+            {
+                result = -1;
+            }
+        }
+    }
+    pthread_mutex_unlock(&cache->mutex);
+
+    if (fclose(fp_out_file) == EOF)
+    {
+        result = -1;
+    }
+
+    return result;
+}
+
+
+// Load the encoder codebooks saved by saveCodebookCache(). Returns 0 if successful and -1 if unsuccessful.
+int loadCodebookCache(codebook_cache *cache, const char *file_name)
+{
+    FILE *fp_in_file = fopen(file_name, "r");
+    codebook *book = NULL;
+    int code_length;
+    int tree_size;
+
+    if (fp_in_file == NULL)
+    {
+        return -1;
+    }
+
+    while (1)
+    {
+        book = calloc(1, sizeof(codebook));
+        if (book == NULL)
+        {
+            break;
+        }
+        book->encoded_characters_table = calloc(NUM_ASCII, sizeof(*book->encoded_characters_table));
+        if (book->encoded_characters_table == NULL)
+        {
+            break;
+        }
+
+        if (fread(&book->key, sizeof(book->key), 1, fp_in_file) != 1)
+        {
+            // The end of the file, every codebook was loaded
+            freeCodebook(book);
+            fclose(fp_in_file);
+            return 0;
+        }
+        if (fread(&book->efficiency, sizeof(book->efficiency), 1, fp_in_file) != 1)
+        {
+            break;
+        }
+
+        for (int character = 0; character < NUM_ASCII; character++)
+        {
+            code_length = fgetc(fp_in_file);
+            if (code_length == EOF || code_length >= MAX_ENCODED_CHARACTER_LENGTH
+                || fread(book->encoded_characters_table[character], 1, code_length, fp_in_file) != (size_t)code_length)
+            {
+                code_length = -1;
+                break;
+            }
+        }
+        if (code_length == -1)
+        {
+            break;
+        }
+
+        // The tree is needed for the header of the compressed files
+        book->root = buildTreeFromCodes(book->encoded_characters_table);
+        if (book->root == NULL || (tree_size = countFullTreeNodes(book->root)) < 3)
+        {
+            break;
+        }
+        book->tree_size = tree_size;
+        book->references = 1;  // only the cache uses it
+
+        pthread_mutex_lock(&cache->mutex);
+        insertCodebook(cache, book);
+        pthread_mutex_unlock(&cache->mutex);
+    }
+
+    // Failed to allocate memory or the file is corrupted
+    if (book)
+    {
+        freeCodebook(book);
+    }
+    fclose(fp_in_file);
+
+    return -1;
+}
+
+
+// Quantize the frequency table (roughly the ideal code length of every character) and hash it, so that similar tables get the same fingerprint
+uint64_t fingerprintFrequencyTable(int *frequency_table)
+{
+    unsigned char quantized_table[NUM_ASCII];
+    long total = 0;  // number of characters in the file
+    long ratio;
+
+    for (int i = 0; i < NUM_ASCII; i++)
+    {
+        total += frequency_table[i];
+    }
+
+    // A character that makes up 1/ratio of the file ideally gets a code of log2(ratio) bits
+    for (int i = 0; i < NUM_ASCII; i++)
+    {
+        quantized_table[i] = 0;
+        if (frequency_table[i])
+        {
+            quantized_table[i] = 1;
+            for (ratio = total / frequency_table[i]; ratio > 1; ratio >>= 1)
+            {
+                quantized_table[i]++;
+            }
+        }
+    }
+
+    return hashBytes(quantized_table, sizeof(quantized_table));
+}
+
+
+// Hash a buffer with 64-bit FNV-1a
+uint64_t hashBytes(const unsigned char *bytes, size_t size)
+{
+    uint64_t hash = FNV_OFFSET_BASIS;
+
+    for (size_t i = 0; i < size; i++)
+    {
+        hash = (hash ^ bytes[i]) * FNV_PRIME;
+    }
+
+    return hash;
+}
+
+
+// Size of the content in bits when encoded with encoded_characters_table. Returns -1 if a character in frequency_table has no code.
+double encodedSizeInBits(int *frequency_table, char encoded_characters_table[NUM_ASCII][MAX_ENCODED_CHARACTER_LENGTH])
+{
+    double size = 0;
+
+    for (int i = 0; i < NUM_ASCII; i++)
+    {
+        if (frequency_table[i])
+        {
+            if (encoded_characters_table[i][0] == '\0')
+            {
+                return -1;
+            }
+            size += (double)frequency_table[i] * strlen(encoded_characters_table[i]);
+        }
+    }
+
+    return size;
+}
+
+
+// The smallest possible size of the content in bits when every character is encoded separately (Shannon entropy times the number of characters)
+double entropyInBits(int *frequency_table)
+{
+    double total = 0;
+    double size = 0;
+
+    for (int i = 0; i < NUM_ASCII; i++)
+    {
+        total += frequency_table[i];
+    }
+
+    for (int i = 0; i < NUM_ASCII; i++)
+    {
+        if (frequency_table[i])
+        {
+            size += frequency_table[i] * log2(total / frequency_table[i]);
+        }
+    }
+
+    return size;
+}
+
+
+// Rebuild a Huffman tree from the codes of its characters (e.g. "001" means left, left, right). Returns the root or NULL if the codes don't form a full tree.
+node *buildTreeFromCodes(char encoded_characters_table[NUM_ASCII][MAX_ENCODED_CHARACTER_LENGTH])
+{
+    // The frequency of a node marks whether it is a leaf (1) or a parent (0)
+    node *root = createNode('\0', 0, NULL, NULL);
+    node *trav;
+    node **p_child;
+
+    if (root == NULL)
+    {
+        return NULL;
+    }
+
+    for (int character = 0; character < NUM_ASCII; character++)
+    {
+        if (encoded_characters_table[character][0] == '\0')
+        {
+            continue;
+        }
+
+        // Follow the code from the root, creating the missing parent nodes on the way
+        trav = root;
+        for (char *bit = encoded_characters_table[character]; *bit != '\0'; bit++)
+        {
+            if (trav->frequency == 1 || (*bit != '0' && *bit != '1'))
+            {
+                // A code can't go through a leaf
+                freeBinaryTree(root);
+                return NULL;
+            }
+
+            p_child = *bit == '0' ? &trav->left : &trav->right;
+            if (*p_child == NULL)
+            {
+                *p_child = createNode('\0', 0, NULL, NULL);
+                if (*p_child == NULL)
+                {
+                    freeBinaryTree(root);
+                    return NULL;
+                }
+            }
+            trav = *p_child;
+        }
+
+        // The code must end at a new leaf, not at a parent of other characters
+        if (trav->left || trav->right || trav->frequency == 1)
+        {
+            freeBinaryTree(root);
+            return NULL;
+        }
+        trav->character = character;
+        trav->frequency = 1;
+    }
+
+    return root;
+}
+
+
+// Count the nodes of a tree. Returns -1 if a node has only one child (every node of a Huffman tree has either zero or two children).
+int countFullTreeNodes(node *root)
+{
+    int left_nodes, right_nodes;
+
+    if (root->left == NULL && root->right == NULL)
+    {
+        return 1;
+    }
+    if (root->left == NULL || root->right == NULL)
+    {
+        return -1;
+    }
+
+    left_nodes = countFullTreeNodes(root->left);
+    right_nodes = countFullTreeNodes(root->right);
+    if (left_nodes == -1 || right_nodes == -1)
+    {
+        return -1;
+    }
+
+    return 1 + left_nodes + right_nodes;
+}
@@ -0,0 +1,101 @@
+/*
+ * Data structures, macros and function declarations of the cache of built Huffman trees (codebooks),
+ * used both in encode and decode when many files are processed by the same process
+*/
+
+
+#ifndef CODEBOOK_CACHE_H
+#define CODEBOOK_CACHE_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include "encode.h"
+
+#define CODEBOOK_CACHE_CAPACITY 64  // Max number of codebooks kept in a cache, the least recently used one is evicted first
+// A cached codebook is used for a file only if it encodes the file at most this much worse (relative to the entropy of the file)
+// than it encoded the file it was built for
+#define CODEBOOK_CACHE_MAX_PENALTY 0.02
+
+
+// A Huffman tree and the tables built from it, shared by the cache and the files that are being encoded or decoded with it
+typedef struct codebook
+{
+    uint64_t key;  // fingerprint of the frequency table (encoder) or hash of the serialized tree (decoder)
+    node *root;
+    unsigned short int tree_size;  // number of nodes in the Huffman tree
+    char (*encoded_characters_table)[MAX_ENCODED_CHARACTER_LENGTH];  // Huffman codes of the characters (encoder only)
+    double efficiency;  // encoded size / entropy of the file the codebook was built for (encoder only)
+    unsigned char *serialized_tree;  // the tree as stored in the header of a compressed file (decoder only)
+    size_t serialized_tree_size;
+    unsigned long last_used;  // value of the cache clock when the codebook was last found or added
+    int references;  // the cache holds one reference while the codebook is in it, every user holds one more
+} codebook;
+
+// Least recently used codebooks, safe to use from many threads
+typedef struct codebook_cache
+{
+    codebook *entries[CODEBOOK_CACHE_CAPACITY];
+    unsigned long clock;  // incremented on every lookup, used to find the least recently used codebook
+    unsigned long hits;
+    unsigned long misses;
+    pthread_mutex_t mutex;
+} codebook_cache;
+
+
+// Initialize an empty cache
+void initCodebookCache(codebook_cache *cache);
+
+// Free all codebooks in the cache that are not used any more
+void freeCodebookCache(codebook_cache *cache);
+
+// Find a codebook built for a similar frequency table that can encode every character in frequency_table without a significant penalty.
+// Returns the codebook, which must be released with releaseCodebook(), or NULL if there is none.
+codebook *findEncoderCodebook(codebook_cache *cache, int *frequency_table);
+
+// Add a codebook built for frequency_table. The cache takes ownership of root if successful.
+// Returns the codebook, which must be released with releaseCodebook(), or NULL if unsuccessful.
+codebook *addEncoderCodebook(codebook_cache *cache, int *frequency_table, node *root, unsigned short int tree_size,
+                             char encoded_characters_table[NUM_ASCII][MAX_ENCODED_CHARACTER_LENGTH]);
+
+// Find the tree reconstructed from the same serialized tree. Returns the codebook, which must be released with releaseCodebook(), or NULL if there is none.
+codebook *findDecoderCodebook(codebook_cache *cache, const unsigned char *serialized_tree, size_t serialized_tree_size);
+
+// Add a tree reconstructed from serialized_tree. The cache takes ownership of root if successful.
+// Returns the codebook, which must be released with releaseCodebook(), or NULL if unsuccessful.
+codebook *addDecoderCodebook(codebook_cache *cache, const unsigned char *serialized_tree, size_t serialized_tree_size,
+                             node *root, unsigned short int tree_size);
+
+// Give up a reference to a codebook returned by the functions above
+void releaseCodebook(codebook_cache *cache, codebook *book);
+
+// Put a codebook into the cache, evicting the least recently used one (or one with the same key) if needed. The mutex must be locked.
+void insertCodebook(codebook_cache *cache, codebook *book);
+
+// Free a codebook and its tree. Used when the last reference is released.
+void freeCodebook(codebook *book);
+
+// Save the encoder codebooks in a file. Returns 0 if successful and -1 if unsuccessful.
+int saveCodebookCache(codebook_cache *cache, const char *file_name);
+
+// Load the encoder codebooks saved by saveCodebookCache(). Returns 0 if successful and -1 if unsuccessful.
+int loadCodebookCache(codebook_cache *cache, const char *file_name);
+
+// Quantize the frequency table (roughly the ideal code length of every character) and hash it, so that similar tables get the same fingerprint
+uint64_t fingerprintFrequencyTable(int *frequency_table);
+
+// Hash a buffer with 64-bit FNV-1a
+uint64_t hashBytes(const unsigned char *bytes, size_t size);
+
+// Size of the content in bits when encoded with encoded_characters_table. Returns -1 if a character in frequency_table has no code.
+double encodedSizeInBits(int *frequency_table, char encoded_characters_table[NUM_ASCII][MAX_ENCODED_CHARACTER_LENGTH]);
+
+// Rebuild a Huffman tree from the codes of its characters (e.g. "001" means left, left, right). Returns the root or NULL if the codes don't form a full tree.
+node *buildTreeFromCodes(char encoded_characters_table[NUM_ASCII][MAX_ENCODED_CHARACTER_LENGTH]);
+
+// Count the nodes of a tree. Returns -1 if a node has only one child (every node of a Huffman tree has either zero or two children).
+int countFullTreeNodes(node *root);
+
+// The smallest possible size of the content in bits when every character is encoded separately (Shannon entropy times the number of characters)
+double entropyInBits(int *frequency_table);
+
+#endif
@@ -4,30 +4,11 @@
 */
 
 
+#include <errno.h>
+#include <unistd.h>
 #include "common.h"
 
 
-int getFileName(int argc, char *argv[], char *filename, size_t max_length)
-{
-    if (argc == 2)
-    {
-        if (strlen(argv[1]) > max_length)
-        { 
-            printf("File name is too long!");
-            return -1;
-        }
-        strcpy(filename, argv[1]);
-    }
-    else
-    {
-        printf("Usage: %s <file name>\n", argv[0]);
-        return -1;
-    }
-
-    return 0;
-}
-
-
 // Recursively free memory used by the Huffman tree
 void freeBinaryTree(node *root)
 {
@@ -41,7 +22,7 @@ void freeBinaryTree(node *root)
 
 
 // Create a new Huffman tree node
-node *createNode(char character, int frequency, node *left, node *right)
+node *createNode(int character, int frequency, node *left, node *right)
 {
     node *new_node = malloc(sizeof(node));
     if (new_node == NULL)
@@ -58,7 +39,7 @@ node *createNode(char character, int frequency, node *left, node *right)
 
 
 // Create a new priority queue element
-priority_queue_element *createPriorityQueueElement(char character, int frequency, node *left, node *right)
+priority_queue_element *createPriorityQueueElement(int character, int frequency, node *left, node *right)
 {
     priority_queue_element *new_element = malloc(sizeof(priority_queue_element));
     if (new_element == NULL)
@@ -80,7 +61,7 @@ priority_queue_element *createPriorityQueueElement(char character, int frequency
 
 
 // Push a new element to the top of the priority queue. Returns 0 if successful and -1 if unsuccessful.
-int pushToPriorityQueue(priority_queue_element **p_priority_queue, char character, int frequency, node *left, node *right)
+int pushToPriorityQueue(priority_queue_element **p_priority_queue, int character, int frequency, node *left, node *right)
 {
     priority_queue_element *new_element = createPriorityQueueElement(character, frequency, left, right);
     if (new_element == NULL)
@@ -95,40 +76,6 @@ int pushToPriorityQueue(priority_queue_element **p_priority_queue, char characte
 }
 
 
-// Function to insert a node into the priority queue into the correct position according to its frequency. Returns 0 if successful and -1 if unsuccessful.
-int insertIntoPriorityQueue(priority_queue_element **p_priority_queue, char character, int frequency, node *left, node *right)
-{
-    priority_queue_element *next_node = *p_priority_queue;
-    priority_queue_element *previous_node = NULL;
-    priority_queue_element *new_element = createPriorityQueueElement(character, frequency, left, right);
-    
-    if (new_element == NULL)
-    {
-        return -1;
-    }
-
-    while (next_node && next_node->pnode->frequency <= frequency)
-    {
-        previous_node = next_node;
-        next_node = next_node->next;
-    }
-
-    // If previous_node is still NULL, the new node should be the head of the list
-    if (previous_node == NULL)
-    {
-        new_element->next = *p_priority_queue;
-        *p_priority_queue = new_element;
-    }
-    else
-    {
-        new_element->next = next_node;
-        previous_node->next = new_element;
-    }
-
-    return 0;
-}
-
-
 // Pop an element from the priority queue
 node *popPriorityQueue(priority_queue_element **p_priority_queue)
 {
@@ -157,4 +104,182 @@ void freePriorityQueue(priority_queue_element **p_priority_queue)
         freeBinaryTree(temp);
     }
     while (temp != NULL);
-}
\ No newline at end of file
+}
+
+
+// Returns 1 if element a has to be popped before element b
+int isBeforeInHeap(node_heap_element *a, node_heap_element *b)
+{
+    return a->pnode->frequency < b->pnode->frequency || (a->pnode->frequency == b->pnode->frequency && a->order < b->order);
+}
+
+
+// Allocate a heap for capacity nodes. Returns 0 if successful and -1 if unsuccessful.
+int initNodeHeap(node_heap *heap, int capacity)
+{
+    heap->elements = malloc(sizeof(node_heap_element) * (capacity > 0 ? capacity : 1));
+    heap->size = 0;
+    heap->capacity = capacity;
+    heap->next_order = 0;
+    if (heap->elements == NULL)
+    {
+        printf("Failed to allocate memory for the priority queue!\n");
+        return -1;
+    }
+    return 0;
+}
+
+
+// Push a node into the heap. Returns 0 if successful and -1 if the heap is full.
+int pushNodeHeap(node_heap *heap, node *pnode)
+{
+    node_heap_element new_element = {pnode, heap->next_order++};
+    int i = heap->size;
+
+    if (heap->size == heap->capacity)
+    {
+        return -1;
+    }
+    heap->size++;
+
+    // Move the parents down until the new element is not before its parent
+    while (i > 0 && isBeforeInHeap(&new_element, &heap->elements[(i - 1) / 2]))
+    {
+        heap->elements[i] = heap->elements[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    heap->elements[i] = new_element;
+
+    return 0;
+}
+
+
+// Pop the node with the lowest frequency from the heap. Returns NULL if the heap is empty.
+node *popNodeHeap(node_heap *heap)
+{
+    node *top;
+    node_heap_element last;
+    int i = 0, child;
+
+    if (heap->size == 0)
+    {
+        return NULL;
+    }
+    top = heap->elements[0].pnode;
+    last = heap->elements[--heap->size];
+
+    // Move the last element down from the root, swapping it with the child that has to be popped first
+    while ((child = 2 * i + 1) < heap->size)
+    {
+        if (child + 1 < heap->size && isBeforeInHeap(&heap->elements[child + 1], &heap->elements[child]))
+        {
+            child++;
+        }
+        if (!isBeforeInHeap(&heap->elements[child], &last))
+        {
+            break;
+        }
+        heap->elements[i] = heap->elements[child];
+        i = child;
+    }
+    heap->elements[i] = last;
+
+    return top;
+}
+
+
+// Free the heap and the trees of the nodes still in it
+void freeNodeHeap(node_heap *heap)
+{
+    for (int i = 0; i < heap->size; i++)
+    {
+        freeBinaryTree(heap->elements[i].pnode);
+    }
+    free(heap->elements);
+    heap->elements = NULL;
+    heap->size = 0;
+}
+
+
+// Write the whole buffer to a file descriptor. Returns 0 if successful and -1 if unsuccessful.
+int writeAll(int fd, const void *buffer, size_t size)
+{
+    const char *data = buffer;
+    ssize_t bytes_written;
+
+    // write() may write less than requested, e.g. when the socket buffer is full
+    while (size > 0)
+    {
+        bytes_written = write(fd, data, size);
+        if (bytes_written == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+        data += bytes_written;
+        size -= bytes_written;
+    }
+
+    return 0;
+}
+
+
+// Read exactly size bytes from a file descriptor. Returns 0 if successful and -1 if unsuccessful or the end of the file was reached.
+int readAll(int fd, void *buffer, size_t size)
+{
+    char *data = buffer;
+    ssize_t bytes_read;
+
+    while (size > 0)
+    {
+        bytes_read = read(fd, data, size);
+        if (bytes_read == -1 && errno == EINTR)
+        {
+            continue;
+        }
+        if (bytes_read <= 0)
+        {
+            return -1;
+        }
+        data += bytes_read;
+        size -= bytes_read;
+    }
+
+    return 0;
+}
+
+
+// Returns a description of one of the error codes in common.h, for callers that report errors returned by functions that don't print them
+const char *describeError(int error)
+{
+    switch (error)
+    {
+        case INVALID_FILE_NAME:
+            return "invalid file name";
+        case FAIL_OPEN_INPUT_FILE:
+            return "failed to open or read the input";
+        case FAIL_CREATE_HUFFMAN_TREE:
+            return "failed to create the Huffman tree";
+        case FAIL_OPEN_OUTPUT_FILE:
+            return "failed to open the output";
+        case FAIL_WRITE_HEADER:
+            return "failed to write the header";
+        case FAIL_WRITE_BODY:
+            return "failed to write the content";
+        case FAIL_READ_HEADER:
+            return "the header of a block is not valid or the input ends in the middle of a block";
+        case FAIL_READ_BODY:
+            return "the encoded content is not valid";
+        case FAIL_SOCKET:
+            return "failed to communicate over the socket";
+        case FAIL_ALLOCATE_MEMORY:
+            return "failed to allocate memory";
+        case FAIL_REQUEST_TOO_LARGE:
+            return "the request is too large";
+        default:
+            return "unknown error";
+    }
+}
@@ -12,9 +12,24 @@
 #include <stdlib.h>
 #include <limits.h>
 
-#define FILE_NAME_MAX_LENGTH 100  // Max length of the name of the unencoded file
 #define COMPRESSED_FILE_EXTENSION ".huff"  // the extension of the encoded file
 #define COMPRESSED_FILE_EXTENSION_LENGTH sizeof(COMPRESSED_FILE_EXTENSION)  // length of the extension of the encoded file
+#define COPY_BUFFER_SIZE 4096  // Size of the buffer used when content is copied as it is
+
+// Block types, stored in the header of the compressed file after the size of the input file
+#define BLOCK_TYPE_HUFFMAN 0  // The content is encoded with the Huffman tree serialized in the header
+#define BLOCK_TYPE_RAW 1  // The content is stored as it is, because encoding would not make it smaller
+#define BLOCK_TYPE_RUN 2  // The content is a single character repeated, only the character is stored in the header
+#define BLOCK_TYPE_PAIRS 3  // The content is encoded with a Huffman tree whose symbols are characters and frequent pairs of characters
+#define BLOCK_TYPE_REUSE 4  // The content is encoded with the Huffman tree of an earlier BLOCK_TYPE_HUFFMAN block, the header holds the distance back to it
+#define BLOCK_TYPE_INDEX 5  // Empty block ending an append, holds the distance back to the latest BLOCK_TYPE_HUFFMAN block (or -1)
+
+// Number of ASCII characters. Used to determine the size of frequency_table and encoded_characters_table
+#define NUM_ASCII 256
+// Max number of pairs of characters coded as single symbols in a BLOCK_TYPE_PAIRS block.
+// Symbols 0-255 are the characters, symbol NUM_ASCII + i is the i-th pair in the header of the block.
+#define MAX_PAIR_SYMBOLS 768
+#define PAIR_SYMBOL_BITS 10  // bits of a symbol in a serialized tree of a BLOCK_TYPE_PAIRS block (enough for NUM_ASCII + MAX_PAIR_SYMBOLS)
 
 // Error codes
 #define INVALID_FILE_NAME 1
@@ -25,45 +40,83 @@
 #define FAIL_WRITE_BODY 6
 #define FAIL_READ_HEADER 7
 #define FAIL_READ_BODY 8
+#define FAIL_SOCKET 9
+#define FAIL_ALLOCATE_MEMORY 10
+#define FAIL_REQUEST_TOO_LARGE 11
 
 
 // Node in the Huffman tree
 typedef struct node
 {
-    char character;
+    int character;  // the character of a leaf (or its symbol in a BLOCK_TYPE_PAIRS block)
     int frequency; // How many times the character is encountered
     struct node *left, *right;
 } node;
 
-// Element in the priority queue where Huffman tree nodes are sorted by their character's frequency
+// Element of the stack used to reconstruct a serialized Huffman tree
 typedef struct priority_queue_element
 {
     node *pnode;
     struct priority_queue_element *next;
 } priority_queue_element;
 
-// Get the name of the file that will be compressed from the CLA
-int getFileName(int argc, char *argv[], char *filename, size_t max_length);
+// Element of the binary heap used to build a Huffman tree
+typedef struct node_heap_element
+{
+    node *pnode;
+    unsigned long order;  // when the node was pushed, nodes with equal frequencies are popped in the order they were pushed
+} node_heap_element;
+
+// Binary min-heap where Huffman tree nodes are sorted by their frequency. Push and pop take O(log n) for alphabets of any size.
+typedef struct node_heap
+{
+    node_heap_element *elements;
+    int size;
+    int capacity;
+    unsigned long next_order;
+} node_heap;
 
 // Recursively free memory used by the Huffman tree
 void freeBinaryTree(node *root);
 
 // Create a new Huffman tree node
-node *createNode(char character, int frequency, node *left, node *right);
+node *createNode(int character, int frequency, node *left, node *right);
 
 // Create a new priority queue element
-priority_queue_element *createPriorityQueueElement(char character, int frequency, node *left, node *right);
+priority_queue_element *createPriorityQueueElement(int character, int frequency, node *left, node *right);
 
 // Push a new element to the top of the priority queue. Returns 0 if successful and -1 if unsuccessful.
-int pushToPriorityQueue(priority_queue_element **p_priority_queue, char character, int frequency, node *left, node *right);
-
-// insert a node into the priority queue in the correct position according to its frequency. Returns 0 if successful and -1 if unsucessful.
-int insertIntoPriorityQueue(priority_queue_element **p_priority_queue, char character, int frequency, node *left, node *right);
+int pushToPriorityQueue(priority_queue_element **p_priority_queue, int character, int frequency, node *left, node *right);
 
 // Pop an element from the priority queue
 node *popPriorityQueue(priority_queue_element **p_priority_queue);
 
-// ree priority queue and its nodes. Used when failed to allocate memory for a new element and must exit the program.
+// Free priority queue and its nodes. Used when failed to allocate memory for a new element and must exit the program.
 void freePriorityQueue(priority_queue_element **p_priority_queue);
 
+// Allocate a heap for capacity nodes. Returns 0 if successful and -1 if unsuccessful.
+int initNodeHeap(node_heap *heap, int capacity);
+
+// Push a node into the heap. Returns 0 if successful and -1 if the heap is full.
+int pushNodeHeap(node_heap *heap, node *pnode);
+
+// Pop the node with the lowest frequency from the heap. Returns NULL if the heap is empty.
+node *popNodeHeap(node_heap *heap);
+
+// Free the heap and the trees of the nodes still in it
+void freeNodeHeap(node_heap *heap);
+
+// Returns 1 if element a has to be popped before element b
+int isBeforeInHeap(node_heap_element *a, node_heap_element *b);
+
+
+// Write the whole buffer to a file descriptor. Returns 0 if successful and -1 if unsuccessful.
+int writeAll(int fd, const void *buffer, size_t size);
+
+// Read exactly size bytes from a file descriptor. Returns 0 if successful and -1 if unsuccessful or the end of the file was reached.
+int readAll(int fd, void *buffer, size_t size);
+
+// Returns a description of one of the error codes in common.h, for callers that report errors returned by functions that don't print them
+const char *describeError(int error);
+
 #endif
\ No newline at end of file
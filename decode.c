@@ -1,108 +1,295 @@
 /*
- * Decode a .huff file created by ./encode
- * Usage: ./encode <huffman encoded file>
+ * Decode a file created by encodeFile()
 */
 
 #include "decode.h"
+#include "codebook_cache.h"
 
 
-int main(int argc, char *argv[])
+// Decode the content of fp_in_file, created by encodeFile(), into fp_out_file. Returns 0 if successful or one of the error codes in common.h.
+// Trees that were already reconstructed are taken from cache (NULL to always reconstruct them).
+int decodeFile(FILE *fp_in_file, FILE *fp_out_file, codebook_cache *cache, long max_decoded_size)
 {
-    char in_file_name[FILE_NAME_MAX_LENGTH + COMPRESSED_FILE_EXTENSION_LENGTH] = {'\0'};  // container for the name of the compressed input file
-    char out_file_name[FILE_NAME_MAX_LENGTH + 8] = "decoded_";  // The name of the output decoded file
-    node *root;  // The root of the reconstructed Huffman tree
-    FILE *fp_in_file = NULL;  // File pointer for the input file
-    FILE *fp_out_file = NULL;  // File pointer for the output file
+    int result;
+    int next_character;
+
+    // The blocks follow each other until the end of the file (large files are encoded in several blocks)
+    do
+    {
+        result = decodeBlock(fp_in_file, fp_out_file, cache, max_decoded_size == -1 ? NULL : &max_decoded_size);
+        if (result != 0)
+        {
+            return result;
+        }
+    }
+    while ((next_character = fgetc(fp_in_file)) != EOF && ungetc(next_character, fp_in_file) != EOF);
+
+    return 0;
+}
+
+
+// Decode a single block (its header and content) from fp_in_file into fp_out_file. The size of the block is subtracted from *p_remaining_size
+// before it is decoded (NULL for no limit). Returns 0 if successful or one of the error codes in common.h.
+int decodeBlock(FILE *fp_in_file, FILE *fp_out_file, codebook_cache *cache, long *p_remaining_size)
+{
+    bit_reader reader = {fp_in_file, 0, 0, NULL, 0, 0};  // Reads the serialized tree and the encoded content bit by bit
+    node *root = NULL;  // The root of the reconstructed Huffman tree
+    codebook *book = NULL;  // The cached codebook that owns root or NULL if root is not cached
     long decoded_file_size;  // The size of the unencoded input file (number of characters)
+    unsigned char block_type;  // how the content is stored in the compressed file (BLOCK_TYPE_HUFFMAN, BLOCK_TYPE_RAW, BLOCK_TYPE_RUN or BLOCK_TYPE_PAIRS)
     unsigned short int tree_size; // number of nodes in the Huffman tree
+    unsigned char pairs[MAX_PAIR_SYMBOLS][2];  // the characters of every pair symbol (BLOCK_TYPE_PAIRS)
+    unsigned short int num_pairs = 0;
+    long block_offset = ftell(fp_in_file);  // where the block starts, BLOCK_TYPE_REUSE refers to an earlier block by the distance back to it
+    long codebook_distance;  // distance back to the block with the Huffman tree (BLOCK_TYPE_REUSE and BLOCK_TYPE_INDEX)
+    int repeated_character = 0;  // the only character of a BLOCK_TYPE_RUN file
+    int result;  // result of writing the decoded content
+
+    // Read the size of the unencoded file and the block type from the header of the compressed file.
+    if (fread(&decoded_file_size, sizeof(decoded_file_size), 1, fp_in_file) < 1
+        || fread(&block_type, sizeof(block_type), 1, fp_in_file) < 1)
+    {
+        printf("Failed to read the header of the input file!");
+        return FAIL_READ_HEADER;
+    }
+    if (decoded_file_size < 0)
+    {
+        printf("Invalid size in the header of the input file!");
+        return FAIL_READ_HEADER;
+    }
 
-    // Get the name of the file that will be decompressed from the CLA; Make sure it ends with COMPRESSED_FILE_EXTENSION (.huff)
-    if ((getFileName(argc, argv, in_file_name, FILE_NAME_MAX_LENGTH + COMPRESSED_FILE_EXTENSION_LENGTH) == -1))
+    // The size comes from the input, it is checked before anything is decoded (a BLOCK_TYPE_RUN header of a few bytes can claim gigabytes)
+    if (p_remaining_size)
     {
-        return INVALID_FILE_NAME;
+        if (decoded_file_size > *p_remaining_size)
+        {
+            printf("The decoded content is larger than allowed!");
+            return FAIL_REQUEST_TOO_LARGE;
+        }
+        *p_remaining_size -= decoded_file_size;
     }
 
-    if ((strlen(in_file_name) < COMPRESSED_FILE_EXTENSION_LENGTH + 1)
-        || (strcmp(in_file_name + strlen(in_file_name) - COMPRESSED_FILE_EXTENSION_LENGTH + 1, COMPRESSED_FILE_EXTENSION) != 0))
+    // The pairs of characters coded as single symbols come before the Huffman tree
+    if (block_type == BLOCK_TYPE_PAIRS)
     {
-        printf("The input file must have %s extension\n", COMPRESSED_FILE_EXTENSION);
-        return INVALID_FILE_NAME;
+        if (fread(&num_pairs, sizeof(num_pairs), 1, fp_in_file) < 1 || num_pairs > MAX_PAIR_SYMBOLS
+            || fread(pairs, 2, num_pairs, fp_in_file) != num_pairs)
+        {
+            printf("Failed to read the header of the input file!");
+            return FAIL_READ_HEADER;
+        }
     }
 
-    // Open the input .huff file that will be decoded
-    fp_in_file = fopen(in_file_name, "r");
-    if (fp_in_file == NULL)
+    if (block_type == BLOCK_TYPE_HUFFMAN || block_type == BLOCK_TYPE_PAIRS)
+    {
+        // Read the size of the Huffman tree and reconstruct the tree from its serialized representation in the header of the comrpessed file.
+        if (fread(&tree_size, sizeof(tree_size), 1, fp_in_file) < 1)
+        {
+            printf("Failed to read the header of the input file!");
+            return FAIL_READ_HEADER;
+        }
+
+        root = getHuffmanTree(&reader, tree_size, block_type == BLOCK_TYPE_PAIRS ? PAIR_SYMBOL_BITS : CHAR_BIT, cache, &book);
+        if (root == NULL)
+        {
+            printf("Failed to create the Huffman tree!");
+            return FAIL_CREATE_HUFFMAN_TREE;
+        }
+    }
+    else if (block_type == BLOCK_TYPE_RUN)
     {
-        printf("Failed to open the input file!\n");
-        return FAIL_OPEN_INPUT_FILE;
+        if ((repeated_character = fgetc(fp_in_file)) == EOF)
+        {
+            printf("Failed to read the header of the input file!");
+            return FAIL_READ_HEADER;
+        }
     }
+    else if (block_type == BLOCK_TYPE_REUSE || block_type == BLOCK_TYPE_INDEX)
+    {
+        if (fread(&codebook_distance, sizeof(codebook_distance), 1, fp_in_file) < 1)
+        {
+            printf("Failed to read the header of the input file!");
+            return FAIL_READ_HEADER;
+        }
 
-    // Read the size of the unencoded file and the size of the Huffman tree from the header of the compressed file.
-    if (fread(&decoded_file_size, sizeof(decoded_file_size), 1, fp_in_file) < 1
-        || fread(&tree_size, sizeof(tree_size), 1, fp_in_file) < 1)
+        // An index only helps the next append to find the latest tree, there is nothing to decode
+        if (block_type == BLOCK_TYPE_INDEX)
+        {
+            return 0;
+        }
+
+        root = getReusedHuffmanTree(fp_in_file, block_offset - codebook_distance, cache, &book);
+        if (root == NULL)
+        {
+            printf("Failed to find the reused Huffman tree!");
+            return FAIL_CREATE_HUFFMAN_TREE;
+        }
+    }
+    else if (block_type != BLOCK_TYPE_RAW)
     {
-        printf("Failed to read the header of the input file!");
-        fclose(fp_in_file);
+        printf("Unknown block type in the header of the input file!");
         return FAIL_READ_HEADER;
     }
 
-    // Reconstruct the Huffman tree from its serialized representation in the header of the comrpessed file.
-    root = ReconstructHuffmanTree(fp_in_file, tree_size);
-    if (root == NULL)
+    // Write the decoded content of the input file into the output file
+    if (block_type == BLOCK_TYPE_HUFFMAN || block_type == BLOCK_TYPE_REUSE)
+    {
+        result = writeDecodedContent(root, decoded_file_size, &reader, fp_out_file, NULL, 0);
+    }
+    else if (block_type == BLOCK_TYPE_PAIRS)
+    {
+        result = writeDecodedContent(root, decoded_file_size, &reader, fp_out_file, pairs, num_pairs);
+    }
+    else if (block_type == BLOCK_TYPE_RAW)
+    {
+        result = writeRawContent(decoded_file_size, fp_in_file, fp_out_file);
+    }
+    else
     {
-        printf("Failed to create the Huffman tree!");
-        fclose(fp_in_file);
-        return FAIL_CREATE_HUFFMAN_TREE;
+        result = writeRepeatedCharacter((char)repeated_character, decoded_file_size, fp_out_file);
     }
 
-    // Open the output file where the compressed content of input file will be stored
-    // Remove the huffman extension from the name of the file
-    strcat(out_file_name, in_file_name);
-    out_file_name[strlen(out_file_name) - COMPRESSED_FILE_EXTENSION_LENGTH + 1] = '\0';
-    fp_out_file = fopen(out_file_name, "w");
-    if (fp_out_file == NULL)
+    if (book)
+    {
+        releaseCodebook(cache, book);
+    }
+    else
     {
-        printf("Failed to open the output file!\n");
-        fclose(fp_in_file);
         freeBinaryTree(root);
-        return FAIL_OPEN_OUTPUT_FILE;
     }
 
-    // Write the decoded content of the input file into the output file
-    if (writeDecodedContent(root, decoded_file_size, fp_in_file, fp_out_file) == EOF)
+    if (result == EOF)
     {
         printf("Failed write the decoded content!");
-        fclose(fp_in_file);
-        fclose(fp_out_file);
-        freeBinaryTree(root);
         return FAIL_READ_BODY;
     }
 
-    printf("\nSuccessfully decoded %s into %s!\n", in_file_name, out_file_name);
+    return 0;
+}
 
-    // Close opened file and free allocated memory
-    fclose(fp_in_file);
-    fclose(fp_out_file);
-    freeBinaryTree(root);
 
-    return 0;
+// Reconstruct the serialized Huffman tree or take it from the cache if the same serialized tree was reconstructed before.
+// *p_book is set to the cached codebook that owns the tree or NULL if the tree is not cached. Returns the root of the tree or NULL if unsuccessful.
+node *getHuffmanTree(bit_reader *reader, unsigned short int tree_size, int symbol_bits, codebook_cache *cache, codebook **p_book)
+{
+    bit_reader tree_reader = {NULL, 0, 0, NULL, 0, 0};  // Reads the serialized tree from memory when it is not in the cache
+    unsigned char *serialized_tree;
+    size_t serialized_tree_bits, serialized_tree_size;
+    node *root;
+    char bit;
+
+    *p_book = NULL;
+    // A tree with less than 3 nodes has a leaf as its root, which has no codes to decode (single characters are BLOCK_TYPE_RUN)
+    if (tree_size < 3)
+    {
+        return NULL;
+    }
+    if (cache == NULL)
+    {
+        return ReconstructHuffmanTree(reader, tree_size, symbol_bits);
+    }
+
+    // The serialized tree has a bit for every node and a symbol for every leaf (a tree with n nodes has (n + 1) / 2 leaves)
+    serialized_tree_bits = tree_size + (size_t)(tree_size + 1) / 2 * symbol_bits;
+    // The first byte of the key is the size of a symbol, the same bits mean different trees for different symbol sizes
+    serialized_tree_size = 1 + (serialized_tree_bits + CHAR_BIT - 1) / CHAR_BIT;
+    serialized_tree = calloc(serialized_tree_size, 1);
+    if (serialized_tree == NULL)
+    {
+        return NULL;
+    }
+    serialized_tree[0] = symbol_bits;
+
+    // Copy the bits of the serialized tree, it is the key of the cache
+    for (size_t i = 0; i < serialized_tree_bits; i++)
+    {
+        if (readBitFromFile(reader, &bit) == EOF)
+        {
+            free(serialized_tree);
+            return NULL;
+        }
+        serialized_tree[1 + i / CHAR_BIT] |= bit << (CHAR_BIT - 1 - i % CHAR_BIT);
+    }
+
+    *p_book = findDecoderCodebook(cache, serialized_tree, serialized_tree_size);
+    if (*p_book)
+    {
+        free(serialized_tree);
+        return (*p_book)->root;
+    }
+
+    // If adding it to the cache fails, the tree is still ours
+    tree_reader.buffer = serialized_tree + 1;
+    tree_reader.buffer_size = serialized_tree_size - 1;
+    root = ReconstructHuffmanTree(&tree_reader, tree_size, symbol_bits);
+    if (root)
+    {
+        *p_book = addDecoderCodebook(cache, serialized_tree, serialized_tree_size, root, tree_size);
+    }
+
+    free(serialized_tree);
+    return root;
+}
+
+
+// Get the Huffman tree of the BLOCK_TYPE_HUFFMAN block at offset, which must be before the current position of fp_in_file (BLOCK_TYPE_REUSE).
+// *p_book is set to the cached codebook that owns the tree or NULL if the tree is not cached. Returns the root of the tree or NULL if unsuccessful.
+node *getReusedHuffmanTree(FILE *fp_in_file, long offset, codebook_cache *cache, codebook **p_book)
+{
+    bit_reader tree_reader = {fp_in_file, 0, 0, NULL, 0, 0};  // Reads the serialized tree of the earlier block
+    long position = ftell(fp_in_file);  // where the content of the current block starts
+    long decoded_file_size;
+    unsigned char block_type;
+    unsigned short int tree_size;
+    node *root = NULL;
+
+    *p_book = NULL;
+    if (position == -1 || offset < 0 || offset >= position || fseek(fp_in_file, offset, SEEK_SET) != 0)
+    {
+        return NULL;
+    }
+
+    // Only the header of the earlier block is read, the tree is usually in the cache already
+    if (fread(&decoded_file_size, sizeof(decoded_file_size), 1, fp_in_file) == 1
+        && fread(&block_type, sizeof(block_type), 1, fp_in_file) == 1 && block_type == BLOCK_TYPE_HUFFMAN
+        && fread(&tree_size, sizeof(tree_size), 1, fp_in_file) == 1)
+    {
+        root = getHuffmanTree(&tree_reader, tree_size, CHAR_BIT, cache, p_book);
+    }
+
+    if (fseek(fp_in_file, position, SEEK_SET) != 0)
+    {
+        if (*p_book)
+        {
+            releaseCodebook(cache, *p_book);
+        }
+        else
+        {
+            freeBinaryTree(root);
+        }
+        *p_book = NULL;
+        return NULL;
+    }
+
+    return root;
 }
 
 
-// Reconstruct the serialized Huffman tree in the header of the compressed file. Returns the root of the tree or NULL if unsuccessful.
-node *ReconstructHuffmanTree(FILE *fp_in_file, unsigned short int tree_size)
+// Reconstruct the serialized Huffman tree in the header of the compressed file, symbol_bits for every leaf's character.
+// Returns the root of the tree or NULL if unsuccessful.
+node *ReconstructHuffmanTree(bit_reader *reader, unsigned short int tree_size, int symbol_bits)
 {
     char bit;
-    char character;
+    int character;
     // Here the priority queue is used as a stack that helps us reconstruct the serialized Huffman tree
-    static priority_queue_element *stack_top = NULL;
+    priority_queue_element *stack_top = NULL;
     node *node1 = NULL, *node2 = NULL;
     node *root = NULL;
 
     // Read all tree nodes from the header of the file
     for (unsigned short int i = 0; i < tree_size; i++)
     {
-        if (readBitFromFile(fp_in_file, &bit) == EOF)
+        if (readBitFromFile(reader, &bit) == EOF)
         {
             freePriorityQueue(&stack_top);
             return NULL;
@@ -111,7 +298,7 @@ node *ReconstructHuffmanTree(FILE *fp_in_file, unsigned short int tree_size)
         if (bit == 1)  // Leaves are denoted as 1 followed by a character (The characters are stored in the leaves of the Huffman tree).
         {
             // If the node is a leaf, push it to the stack
-            if (readCharFromFile(fp_in_file, &character) == EOF || pushToPriorityQueue(&stack_top, character, 1, NULL, NULL) == -1)
+            if (readBitsFromFile(reader, symbol_bits, &character) == EOF || pushToPriorityQueue(&stack_top, character, 1, NULL, NULL) == -1)
             {
                 freePriorityQueue(&stack_top);
                 return NULL;
@@ -124,6 +311,9 @@ node *ReconstructHuffmanTree(FILE *fp_in_file, unsigned short int tree_size)
             node2 = popPriorityQueue(&stack_top);
             if (node1 == NULL || node2 == NULL || pushToPriorityQueue(&stack_top, '\0', 1, node2, node1) == -1)
             {
+                // The popped nodes are in neither the stack nor a new parent
+                freeBinaryTree(node1);
+                freeBinaryTree(node2);
                 freePriorityQueue(&stack_top);
                 return NULL;
             }
@@ -136,6 +326,7 @@ node *ReconstructHuffmanTree(FILE *fp_in_file, unsigned short int tree_size)
     // If the stack is not empty, something went wrong.
     if (stack_top != NULL)
     {
+        freeBinaryTree(root);
         freePriorityQueue(&stack_top);
         return NULL;
     }
@@ -144,8 +335,10 @@ node *ReconstructHuffmanTree(FILE *fp_in_file, unsigned short int tree_size)
 }
 
 
-// Decode an encoded file content using the Huffman tree. Returns 0 if successful and EOF if unsucessful.
-int writeDecodedContent(node *root, long decoded_file_size, FILE *fp_in_file, FILE *fp_out_file)
+// Decode an encoded file content using the Huffman tree. Symbols from NUM_ASCII on are decoded into the characters of pairs (BLOCK_TYPE_PAIRS),
+// pairs is NULL for BLOCK_TYPE_HUFFMAN. Returns 0 if successful and EOF if unsucessful.
+int writeDecodedContent(node *root, long decoded_file_size, bit_reader *reader, FILE *fp_out_file,
+                        unsigned char pairs[MAX_PAIR_SYMBOLS][2], unsigned short int num_pairs)
 {
     node *trav = root; // Used to traverse the Huffman tree
     char bit;
@@ -154,7 +347,7 @@ int writeDecodedContent(node *root, long decoded_file_size, FILE *fp_in_file, FI
     // Follow the tree path from the encoded file content
     while (characters_written < decoded_file_size)
     {
-        if (readBitFromFile(fp_in_file, &bit) == EOF)
+        if (readBitFromFile(reader, &bit) == EOF)
         {
             return EOF;
         }
@@ -168,17 +361,36 @@ int writeDecodedContent(node *root, long decoded_file_size, FILE *fp_in_file, FI
         {
             trav = trav->right;
         }
+        // Only a malformed tree can lead past a leaf
+        if (trav == NULL)
+        {
+            return EOF;
+        }
 
         // If we reached a leaf (the characters are stored in the leafs), 
         // store its code into the decoded file and go back to the root of the Huffman tree.
         if (trav->left == NULL && trav->right == NULL)
         {
-            if (fputc(trav->character, fp_out_file) == EOF)
+            if (trav->character < NUM_ASCII)
             {
-                return EOF;
+                if (fputc(trav->character, fp_out_file) == EOF)
+                {
+                    return EOF;
+                }
+                characters_written++;
+            }
+            else
+            {
+                // A pair yields two characters, it must be one of the pairs in the header and fit into the decoded content
+                if (pairs == NULL || trav->character - NUM_ASCII >= num_pairs || characters_written + 2 > decoded_file_size
+                    || fputc(pairs[trav->character - NUM_ASCII][0], fp_out_file) == EOF
+                    || fputc(pairs[trav->character - NUM_ASCII][1], fp_out_file) == EOF)
+                {
+                    return EOF;
+                }
+                characters_written += 2;
             }
             trav = root;
-            characters_written++;
         }
     }
 
@@ -186,44 +398,93 @@ int writeDecodedContent(node *root, long decoded_file_size, FILE *fp_in_file, FI
 }
 
 
-// Read a char bit by bit using readBitFromFile(). Returns EOF if unsucessful.
-int readCharFromFile(FILE *fp_in_file, char *byte)
+// Copy decoded_file_size characters stored as they are (BLOCK_TYPE_RAW) into the output file. Returns 0 if successful and EOF if unsucessful.
+int writeRawContent(long decoded_file_size, FILE *fp_in_file, FILE *fp_out_file)
+{
+    char buffer[COPY_BUFFER_SIZE];
+    size_t chunk_size;
+
+    while (decoded_file_size > 0)
+    {
+        chunk_size = decoded_file_size < COPY_BUFFER_SIZE ? (size_t)decoded_file_size : COPY_BUFFER_SIZE;
+        if (fread(buffer, 1, chunk_size, fp_in_file) != chunk_size || fwrite(buffer, 1, chunk_size, fp_out_file) != chunk_size)
+        {
+            return EOF;
+        }
+        decoded_file_size -= chunk_size;
+    }
+
+    return 0;
+}
+
+
+// Write a character repeated decoded_file_size times (BLOCK_TYPE_RUN) into the output file. Returns 0 if successful and EOF if unsucessful.
+int writeRepeatedCharacter(char character, long decoded_file_size, FILE *fp_out_file)
+{
+    char buffer[COPY_BUFFER_SIZE];
+    size_t chunk_size;
+
+    memset(buffer, character, sizeof(buffer));
+    while (decoded_file_size > 0)
+    {
+        chunk_size = decoded_file_size < COPY_BUFFER_SIZE ? (size_t)decoded_file_size : COPY_BUFFER_SIZE;
+        if (fwrite(buffer, 1, chunk_size, fp_out_file) != chunk_size)
+        {
+            return EOF;
+        }
+        decoded_file_size -= chunk_size;
+    }
+
+    return 0;
+}
+
+
+// Read num_bits bits into value bit by bit using readBitFromFile(). Returns EOF if unsucessful.
+int readBitsFromFile(bit_reader *reader, int num_bits, int *value)
 {
     char bit;
+
+    *value = 0;
     // Need to read it bit by bit so that it doesn't get read from the file before some other bits that have not filled a byte yet.
-    for (int j = CHAR_BIT - 1; j >= 0; j--)
+    for (int j = num_bits - 1; j >= 0; j--)
     {
-        if (readBitFromFile(fp_in_file, &bit) == EOF)
+        if (readBitFromFile(reader, &bit) == EOF)
         {
             return EOF;
         }
 
-        *byte = ((*byte << 1) | bit);
+        *value = ((*value << 1) | bit);
     }
     return 0;
 }
 
 
 // Reads a byte from a file and returns a bit of the byte on every call. Returns EOF if unsucessful.
-int readBitFromFile(FILE *fp_in_file, char *bit)
+int readBitFromFile(bit_reader *reader, char *bit)
 {
-    static int i_byte;  // fgetc() returns an int so that it can represent every char + EOF
-    static short int remaining_bits = 0;  // Counts how many bits of the byte have been read.
-
     // We can't read an individual bit from a file, but rather a whole byte.
-    if (remaining_bits == 0)
+    if (reader->remaining_bits == 0)
     {
-        if ((i_byte = fgetc(fp_in_file)) == EOF)
+        if (reader->fp_in_file)
+        {
+            reader->i_byte = fgetc(reader->fp_in_file);
+        }
+        else
+        {
+            reader->i_byte = reader->buffer_position < reader->buffer_size ? reader->buffer[reader->buffer_position++] : EOF;
+        }
+
+        if (reader->i_byte == EOF)
         {
             printf("Failed to read a byte from input file!");
             return EOF;
         }
-        remaining_bits = CHAR_BIT;
+        reader->remaining_bits = CHAR_BIT;
     }
 
     // Get the (remaining_bits-1)th bit of the byte (read the bits starting from MSB to LSB)
-    remaining_bits--;
-    *bit = (i_byte >> remaining_bits) & 1;
+    reader->remaining_bits--;
+    *bit = (reader->i_byte >> reader->remaining_bits) & 1;
 
     return 0;
 }
\ No newline at end of file
@@ -1,14 +1,67 @@
+/*
+ * Data structures and function declarations
+ * used for decoding
+*/
+
+
+#ifndef DECODE_H
+#define DECODE_H
+
 #include "common.h"
 
 
-// Reconstruct the serialized Huffman tree in the header of the compressed file. Returns the root of the tree or NULL if unsuccessful.
-node *ReconstructHuffmanTree(FILE *fp_in_file, unsigned short int tree_size);
+struct codebook_cache;  // codebook_cache.h
+struct codebook;
+
+
+// Reads a byte from the input file (or from a buffer if there is no file) and hands out its bits one at a time
+typedef struct bit_reader
+{
+    FILE *fp_in_file;
+    int i_byte;  // fgetc() returns an int so that it can represent every char + EOF
+    short int remaining_bits;  // Counts how many bits of the byte have not been read yet.
+    const unsigned char *buffer;  // Read instead of the file if fp_in_file is NULL
+    size_t buffer_size;
+    size_t buffer_position;  // index of the next byte of the buffer
+} bit_reader;
+
+
+// Decode the content of fp_in_file, created by encodeFile(), into fp_out_file. Returns 0 if successful or one of the error codes in common.h.
+// Trees that were already reconstructed are taken from cache (NULL to always reconstruct them).
+// Fails with FAIL_REQUEST_TOO_LARGE if the decoded content would be larger than max_decoded_size bytes (-1 for no limit).
+int decodeFile(FILE *fp_in_file, FILE *fp_out_file, struct codebook_cache *cache, long max_decoded_size);
 
-// Decode an encoded file content using the Huffman tree. Returns 0 if successful and EOF if unsucessful.
-int writeDecodedContent(node *root, long decoded_file_size, FILE *fp_in_file, FILE *fp_out_file);
+// Decode a single block (its header and content) from fp_in_file into fp_out_file. The size of the block is subtracted from *p_remaining_size
+// before it is decoded (NULL for no limit). Returns 0 if successful or one of the error codes in common.h.
+int decodeBlock(FILE *fp_in_file, FILE *fp_out_file, struct codebook_cache *cache, long *p_remaining_size);
 
-// Read a char bit by bit using readBitFromFile(). Returns EOF if unsucessful.
-int readCharFromFile(FILE *fp_in_file, char *byte);
+// Reconstruct the serialized Huffman tree or take it from the cache if the same serialized tree was reconstructed before.
+// *p_book is set to the cached codebook that owns the tree or NULL if the tree is not cached. Returns the root of the tree or NULL if unsuccessful.
+node *getHuffmanTree(bit_reader *reader, unsigned short int tree_size, int symbol_bits, struct codebook_cache *cache, struct codebook **p_book);
+
+// Get the Huffman tree of the BLOCK_TYPE_HUFFMAN block at offset, which must be before the current position of fp_in_file (BLOCK_TYPE_REUSE).
+// *p_book is set to the cached codebook that owns the tree or NULL if the tree is not cached. Returns the root of the tree or NULL if unsuccessful.
+node *getReusedHuffmanTree(FILE *fp_in_file, long offset, struct codebook_cache *cache, struct codebook **p_book);
+
+// Reconstruct the serialized Huffman tree in the header of the compressed file, symbol_bits for every leaf's character.
+// Returns the root of the tree or NULL if unsuccessful.
+node *ReconstructHuffmanTree(bit_reader *reader, unsigned short int tree_size, int symbol_bits);
+
+// Decode an encoded file content using the Huffman tree. Symbols from NUM_ASCII on are decoded into the characters of pairs (BLOCK_TYPE_PAIRS),
+// pairs is NULL for BLOCK_TYPE_HUFFMAN. Returns 0 if successful and EOF if unsucessful.
+int writeDecodedContent(node *root, long decoded_file_size, bit_reader *reader, FILE *fp_out_file,
+                        unsigned char pairs[MAX_PAIR_SYMBOLS][2], unsigned short int num_pairs);
+
+// Copy decoded_file_size characters stored as they are (BLOCK_TYPE_RAW) into the output file. Returns 0 if successful and EOF if unsucessful.
+int writeRawContent(long decoded_file_size, FILE *fp_in_file, FILE *fp_out_file);
+
+// Write a character repeated decoded_file_size times (BLOCK_TYPE_RUN) into the output file. Returns 0 if successful and EOF if unsucessful.
+int writeRepeatedCharacter(char character, long decoded_file_size, FILE *fp_out_file);
+
+// Read num_bits bits into value bit by bit using readBitFromFile(). Returns EOF if unsucessful.
+int readBitsFromFile(bit_reader *reader, int num_bits, int *value);
 
 // Reads a byte from a file and returns a bit of the byte on every call. Returns EOF if unsucessful.
-int readBitFromFile(FILE *fp_in_file, char *bit);
\ No newline at end of file
+int readBitFromFile(bit_reader *reader, char *bit);
+
+#endif
\ No newline at end of file
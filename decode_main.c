@@ -0,0 +1,67 @@
+/*
+ * Decode .huff files created by ./encode
+ * Usage: ./decode [-j threads] <huffman encoded file or directory>...
+ *        ./decode -s < <huff file> > <file>
+*/
+
+#define _DEFAULT_SOURCE
+
+#include <unistd.h>
+#include "batch.h"
+#include "stream.h"
+
+
+int main(int argc, char *argv[])
+{
+    static batch files;  // Files that will be decompressed, each into decoded_<name without .huff>
+    long num_workers = sysconf(_SC_NPROCESSORS_ONLN);  // Number of threads decoding the files
+    int use_stream = 0;  // Decode stdin into stdout as it arrives instead (-s)
+    int option;
+    int result;
+
+    while ((option = getopt(argc, argv, "j:s")) != -1)
+    {
+        if (option == 's')
+        {
+            use_stream = 1;
+            continue;
+        }
+        if (option == 'j' && (num_workers = strtol(optarg, NULL, 10)) > 0)
+        {
+            continue;
+        }
+        printf("Usage: %s [-j threads] <huffman encoded file or directory>...\n       %s -s < <huff file> > <file>\n", argv[0], argv[0]);
+        return INVALID_FILE_NAME;
+    }
+    // Decode a pipe or a socket chunk by chunk, the characters are written as soon as they are decoded
+    if (use_stream)
+    {
+        return streamDecodeFile(STDIN_FILENO, STDOUT_FILENO);
+    }
+    if (optind == argc)
+    {
+        printf("Usage: %s [-j threads] <huffman encoded file or directory>...\n       %s -s < <huff file> > <file>\n", argv[0], argv[0]);
+        return INVALID_FILE_NAME;
+    }
+    if (num_workers < 1)
+    {
+        num_workers = 1;
+    }
+
+    // Get the names of the files that will be decompressed from the CLA; They must end with COMPRESSED_FILE_EXTENSION (.huff)
+    initBatch(&files, BATCH_DECODE);
+    for (int i = optind; i < argc; i++)
+    {
+        result = addBatchPath(&files, argv[i], 0);
+        if (result != 0)
+        {
+            freeBatch(&files);
+            return result;
+        }
+    }
+
+    result = runBatch(&files, num_workers);
+    freeBatch(&files);
+
+    return result;
+}
@@ -1,116 +1,230 @@
 /*
- * Encode a .txt file using Huffman coding
- * Usage: ./encode <txt input file>
+ * Encode a file using Huffman coding
 */
 
 #include "encode.h"
+#include "codebook_cache.h"
 
 
-int main(int argc, char *argv[])
+// Encode the content of fp_in_file into fp_out_file as a single block using the tables of context.
+// Returns 0 if successful or one of the error codes in common.h.
+int encodeFile(FILE *fp_in_file, FILE *fp_out_file, encoder_context *context)
 {
-    char in_file_name[FILE_NAME_MAX_LENGTH];  // container for the name of the input file that will be compressed
-    char out_file_name[FILE_NAME_MAX_LENGTH + COMPRESSED_FILE_EXTENSION_LENGTH] = {'\0'};  // container for the name of the compressed output file
-    FILE *fp_in_file = NULL;  // File pointer for the input file
-    FILE *fp_out_file = NULL;  // File pointer for the output file
+    char buf_character_code[MAX_ENCODED_CHARACTER_LENGTH] = {'\0'}; // Keeps track of the path in the tree to the character
+    bit_writer writer = {fp_out_file, 0, 0}; // Accumulates the bits of the serialized tree and the encoded content
     node *root = NULL;  // The root of the Huffman tree
-    /*
-    * Table to store characters and their Huffman binary codes.
-    * First dimension corresponds to ASCII character, second dimension is the encoded character (the path in the Huffman tree).
-    * e.g. encoded_characters_table['a'] = "001"
-    * This table is used because otherwise would have to blindly traverse the tree for every character when encoding the input file.
-    * ( In the future might dynamically allocate memory for every character according to its depth in the tree
-    * instead of using a predetermined second dimension of size MAX_ENCODED_CHARACTER_LENGTH )
-    */
-    char encoded_characters_table[NUM_ASCII][MAX_ENCODED_CHARACTER_LENGTH] = { [0 ... NUM_ASCII - 1] = { '\0' } };
+    codebook *book = NULL;  // The cached codebook that owns root or NULL if root is not cached
+    node *pair_root = NULL;  // The root of the Huffman tree of the characters and pairs (BLOCK_TYPE_PAIRS)
     unsigned short int tree_size; // number of nodes in the Huffman tree
-    long in_file_size; // size of the input file - how many characters it contains
+    unsigned short int pair_tree_size; // number of nodes in the Huffman tree of the characters and pairs
+    long encoded_size; // size of the content without the size of the input file and the block type
+    long pair_size; // size of the content of a BLOCK_TYPE_PAIRS block
+    double reused_bits; // size of the content in bits when encoded with the codes of an earlier block or -1 if they don't fit
+    long block_offset = ftell(fp_out_file); // where the block starts in the output file
+    int result; // result of writing the content of the compressed file
+
+    // The context may have been used for another file
+    memset(context->frequency_table, 0, sizeof(context->frequency_table));
+    memset(context->encoded_characters_table, 0, sizeof(context->encoded_characters_table));
+
+    // Count how many times each character is encountered in the input file
+    populateFrequencyTable(fp_in_file, context->frequency_table);
+    context->in_file_size = ftell(fp_in_file);
+
+    // Reuse the tree and the codes built for a file with a similar frequency table
+    if (context->cache)
+    {
+        book = findEncoderCodebook(context->cache, context->frequency_table);
+    }
 
-    // Get the name of the file that will be compressed from the CLA
-    if (getFileName(argc, argv, in_file_name, FILE_NAME_MAX_LENGTH) == -1)
+    if (book)
     {
-        return INVALID_FILE_NAME;
+        root = book->root;
+        tree_size = book->tree_size;
+        memcpy(context->encoded_characters_table, book->encoded_characters_table, sizeof(context->encoded_characters_table));
     }
-    // Open the input txt file that will be compressed
-    fp_in_file = fopen(in_file_name, "r");
-    if (fp_in_file == NULL)
+    else
     {
-        printf("Failed to open the input file!\n");
-        return FAIL_OPEN_INPUT_FILE;
+        // Create the Huffman tree of the input file content (an empty file has no tree)
+        root = createHuffmanTree(context->frequency_table, NUM_ASCII);
+        if (root == NULL && context->in_file_size > 0)
+        {
+            printf("Failed to create the Huffman tree!");
+            return FAIL_CREATE_HUFFMAN_TREE;
+        }
+
+        // Store the huffman codes for each character in a table; get the number of nodes in tehe Huffman tree
+        tree_size = populateEncodedCharactersTable(root, 0, buf_character_code, context->encoded_characters_table);
     }
 
-    // Create the Huffman tree of the input file content
-    root = createHuffmanTree(fp_in_file);
-    if (root == NULL)
+    // Don't spend time encoding content that would not get smaller or that is a single repeated character
+    context->block_type = chooseBlockType(root, tree_size, context->in_file_size, context->frequency_table,
+                                          context->encoded_characters_table);
+
+    encoded_size = context->block_type == BLOCK_TYPE_HUFFMAN
+                   ? huffmanContentSize(tree_size, CHAR_BIT, context->frequency_table, context->encoded_characters_table, NUM_ASCII)
+                   : context->block_type == BLOCK_TYPE_RAW ? context->in_file_size : 1;
+
+    // Coding frequent pairs of characters as single symbols can make text smaller, every decoded symbol yields up to two characters
+    if (context->use_pairs && context->in_file_size > 1
+        && (context->block_type == BLOCK_TYPE_HUFFMAN || context->block_type == BLOCK_TYPE_RAW))
     {
-        printf("Failed to create the Huffman tree!");
-        fclose(fp_in_file);
-        return FAIL_CREATE_HUFFMAN_TREE;
+        pair_root = createPairHuffmanTree(fp_in_file, context, &pair_tree_size);
+        pair_size = pair_root == NULL ? 0 : (long)sizeof(context->num_pairs) + context->num_pairs * 2
+                    + huffmanContentSize(pair_tree_size, PAIR_SYMBOL_BITS, context->symbol_frequency_table,
+                                         context->encoded_symbols_table, NUM_SYMBOLS);
+        if (pair_root && pair_size < encoded_size)
+        {
+            releaseHuffmanTree(context, book, root);
+            book = NULL;
+            root = pair_root;
+            tree_size = pair_tree_size;
+            encoded_size = pair_size;
+            context->block_type = BLOCK_TYPE_PAIRS;
+        }
+        else
+        {
+            freeBinaryTree(pair_root);
+        }
     }
 
-    // Store the huffman codes for each character in a table; get the number of nodes in tehe Huffman tree
-    tree_size = populateEncodedCharactersTable(root, 0, encoded_characters_table);
+    // When appending, the codes of the latest Huffman block are reused if every character has one and no tree would do better
+    if (context->reuse_codebook && context->reuse_offset >= 0 && block_offset > context->reuse_offset
+        && context->block_type != BLOCK_TYPE_RUN)
+    {
+        reused_bits = encodedSizeInBits(context->frequency_table, context->reused_characters_table);
+        if (reused_bits >= 0 && (long)sizeof(long) + ((long)reused_bits + CHAR_BIT - 1) / CHAR_BIT <= encoded_size)
+        {
+            releaseHuffmanTree(context, book, root);
+            book = NULL;
+            root = NULL;
+            context->block_type = BLOCK_TYPE_REUSE;
+        }
+    }
 
-    // Open the output file where the compressed content of input file will be stored
-    strcpy(out_file_name, in_file_name);
-    strcat(out_file_name, COMPRESSED_FILE_EXTENSION);
-    fp_out_file = fopen(out_file_name, "w");
-    if (fp_out_file == NULL)
+    // Only Huffman trees of characters are worth caching (if adding fails, root is still ours)
+    if (book == NULL && context->cache && context->block_type == BLOCK_TYPE_HUFFMAN)
     {
-        printf("Failed to open the output file!\n");
-        fclose(fp_in_file);
-        freeBinaryTree(root);
-        return FAIL_OPEN_OUTPUT_FILE;
+        book = addEncoderCodebook(context->cache, context->frequency_table, root, tree_size, context->encoded_characters_table);
     }
 
     // Write the header of the compressed file
-    in_file_size = ftell(fp_in_file);
-    if (writeHeader(fp_out_file, in_file_size, tree_size, root) == EOF)
+    if (writeHeader(&writer, context->in_file_size, context->block_type, tree_size, root, context->pairs, context->num_pairs,
+                    block_offset - context->reuse_offset) == EOF)
     {
         printf("Failed to write the header of the compressed file!\n");
-        fclose(fp_in_file);
-        fclose(fp_out_file);
-        freeBinaryTree(root);
+        releaseHuffmanTree(context, book, root);
         return FAIL_WRITE_HEADER;
     }
     
     // Write the encoded content of the input file into the output file
+    // (nothing else is needed for BLOCK_TYPE_RUN, the repeated character is in the header)
     fseek(fp_in_file, 0, SEEK_SET);
-    if (writeEncodedFileContent(encoded_characters_table, fp_in_file, fp_out_file) == EOF)
+    if (context->block_type == BLOCK_TYPE_HUFFMAN)
+    {
+        result = writeEncodedFileContent(context->encoded_characters_table, NULL, fp_in_file, &writer);
+    }
+    else if (context->block_type == BLOCK_TYPE_PAIRS)
+    {
+        result = writeEncodedFileContent(context->encoded_symbols_table, context->pair_symbols, fp_in_file, &writer);
+    }
+    else if (context->block_type == BLOCK_TYPE_REUSE)
+    {
+        result = writeEncodedFileContent(context->reused_characters_table, NULL, fp_in_file, &writer);
+    }
+    else if (context->block_type == BLOCK_TYPE_RAW)
+    {
+        result = writeRawFileContent(fp_in_file, fp_out_file);
+    }
+    else
+    {
+        result = 0;
+    }
+
+    releaseHuffmanTree(context, book, root);
+    if (result == EOF)
     {
         printf("Failed to write the encoded content!\n");
-        fclose(fp_in_file);
-        fclose(fp_out_file);
-        freeBinaryTree(root);
         return FAIL_WRITE_BODY;
     }
 
-    printf("\nSuccessfully encoded the file!\n%s is %.2lf%% the size of %s\n", out_file_name,
-           ((double) ftell(fp_out_file) / in_file_size * 100), in_file_name);
-    
-    // Close opened file and free allocated memory
-    fclose(fp_in_file);
-    fclose(fp_out_file);
-    freeBinaryTree(root);
+    // The following appended blocks can reuse the codes of this one
+    if (context->reuse_codebook && context->block_type == BLOCK_TYPE_HUFFMAN)
+    {
+        context->reuse_offset = block_offset;
+        memcpy(context->reused_characters_table, context->encoded_characters_table, sizeof(context->reused_characters_table));
+    }
 
     return 0;
 }
 
 
-// Create a Huffman tree from file content. Returns tree root or NULL if unsuccessful.
-node *createHuffmanTree(FILE *fp_in_file)
+// Free the Huffman tree after encoding a file or give it back to the cache if it is owned by a cached codebook
+void releaseHuffmanTree(encoder_context *context, codebook *book, node *root)
 {
-    int frequency_table[NUM_ASCII] = {0}; // How many times each character is encountered in the file. E.g. frequency_table['a'] = 3
-    priority_queue_element *priority_queue = NULL; // Priority queue where Huffman tree nodes are sorted by their character's frequency
+    if (book)
+    {
+        releaseCodebook(context->cache, book);
+    }
+    else
+    {
+        freeBinaryTree(root);
+    }
+}
 
-    populateFrequencyTable(fp_in_file, frequency_table);
 
-    priority_queue = frequencyTableToPriorityQueue(frequency_table);
+// Create a Huffman tree from a frequency table of num_symbols symbols. Returns tree root or NULL if unsuccessful or if the table is empty.
+node *createHuffmanTree(int *frequency_table, int num_symbols)
+{
+    node_heap priority_queue; // Priority queue where Huffman tree nodes are sorted by their character's frequency
+
+    if (frequencyTableToPriorityQueue(frequency_table, num_symbols, &priority_queue) == -1)
+    {
+        return NULL;
+    }
 
     // Transform the priority queue into a Huffman tree and return the root of the tree
     return priorityQueueToHuffmanTree(&priority_queue);
 }
 
 
+// Choose the pairs of characters coded as single symbols, count the symbols and create their Huffman tree (BLOCK_TYPE_PAIRS).
+// *p_tree_size is set to the number of nodes in the tree. Returns tree root or NULL if unsuccessful or if no pair is frequent enough.
+node *createPairHuffmanTree(FILE *fp_in_file, encoder_context *context, unsigned short int *p_tree_size)
+{
+    char buf_character_code[MAX_ENCODED_CHARACTER_LENGTH] = {'\0'}; // Keeps track of the path in the tree to the symbol
+    node *root;
+
+    // The context may have been used for another file
+    memset(context->pair_frequency_table, 0, sizeof(context->pair_frequency_table));
+    memset(context->symbol_frequency_table, 0, sizeof(context->symbol_frequency_table));
+    memset(context->encoded_symbols_table, 0, sizeof(context->encoded_symbols_table));
+
+    fseek(fp_in_file, 0, SEEK_SET);
+    populatePairFrequencyTable(fp_in_file, context->pair_frequency_table);
+    context->num_pairs = choosePairSymbols(context->pair_frequency_table, context->pair_symbols, context->pairs);
+    if (context->num_pairs == 0)
+    {
+        return NULL;
+    }
+
+    // The pairs take the place of their characters, so the characters get less frequent
+    fseek(fp_in_file, 0, SEEK_SET);
+    populateSymbolFrequencyTable(fp_in_file, context->pair_symbols, context->symbol_frequency_table);
+
+    // A tree of a single symbol would give it an empty code
+    root = createHuffmanTree(context->symbol_frequency_table, NUM_SYMBOLS);
+    if (root && root->left == NULL)
+    {
+        free(root);
+        return NULL;
+    }
+    *p_tree_size = populateEncodedCharactersTable(root, 0, buf_character_code, context->encoded_symbols_table);
+
+    return root;
+}
+
+
 // Populate a frequency table for a given file's content (how many times each character is encountered in the file)
 void populateFrequencyTable(FILE *fp_in_file, int *frequency_table)
 {
@@ -124,66 +238,200 @@ void populateFrequencyTable(FILE *fp_in_file, int *frequency_table)
 }
 
 
+// Populate a frequency table of the pairs of adjacent characters in a given file's content (how many times each pair is encountered in the file)
+void populatePairFrequencyTable(FILE *fp_in_file, int *pair_frequency_table)
+{
+    int previous_character = fgetc(fp_in_file);
+    int character;
+
+    // Every character except the first one ends a pair, e.g. "the" has the pairs "th" and "he"
+    while (previous_character != EOF && (character = fgetc(fp_in_file)) != EOF)
+    {
+        pair_frequency_table[previous_character << CHAR_BIT | character]++;
+        previous_character = character;
+    }
+}
+
+
+// Give a symbol to the most frequent pairs (at most MAX_PAIR_SYMBOLS, each encountered at least PAIR_MIN_FREQUENCY times).
+// Returns the number of chosen pairs.
+unsigned short int choosePairSymbols(int *pair_frequency_table, short int *pair_symbols, unsigned char pairs[MAX_PAIR_SYMBOLS][2])
+{
+    pair_candidate *candidates;
+    int num_candidates = 0;
+    unsigned short int num_pairs;
+
+    for (int i = 0; i < NUM_PAIRS; i++)
+    {
+        pair_symbols[i] = -1;
+        if (pair_frequency_table[i] >= PAIR_MIN_FREQUENCY)
+        {
+            num_candidates++;
+        }
+    }
+    if (num_candidates == 0)
+    {
+        return 0;
+    }
+
+    candidates = malloc(sizeof(pair_candidate) * num_candidates);
+    if (candidates == NULL)
+    {
+        printf("Failed to allocate memory for the pairs!\n");
+        return 0;
+    }
+
+    num_candidates = 0;
+    for (int i = 0; i < NUM_PAIRS; i++)
+    {
+        if (pair_frequency_table[i] >= PAIR_MIN_FREQUENCY)
+        {
+            candidates[num_candidates++] = (pair_candidate){i, pair_frequency_table[i]};
+        }
+    }
+    qsort(candidates, num_candidates, sizeof(pair_candidate), comparePairCandidates);
+
+    num_pairs = num_candidates < MAX_PAIR_SYMBOLS ? num_candidates : MAX_PAIR_SYMBOLS;
+    for (int i = 0; i < num_pairs; i++)
+    {
+        pair_symbols[candidates[i].pair] = NUM_ASCII + i;
+        pairs[i][0] = candidates[i].pair >> CHAR_BIT;
+        pairs[i][1] = candidates[i].pair & UCHAR_MAX;
+    }
+
+    free(candidates);
+    return num_pairs;
+}
+
+
+// Sort pair candidates by decreasing frequency (used by qsort)
+int comparePairCandidates(const void *a, const void *b)
+{
+    const pair_candidate *candidate_a = a;
+    const pair_candidate *candidate_b = b;
+
+    if (candidate_a->frequency != candidate_b->frequency)
+    {
+        return candidate_a->frequency > candidate_b->frequency ? -1 : 1;
+    }
+    return candidate_a->pair - candidate_b->pair;
+}
+
+
+// Populate a frequency table of the symbols a given file's content is split into by readPairSymbol()
+void populateSymbolFrequencyTable(FILE *fp_in_file, short int *pair_symbols, int *symbol_frequency_table)
+{
+    int next_character = fgetc(fp_in_file);
+    int symbol;
+
+    while ((symbol = readPairSymbol(fp_in_file, pair_symbols, &next_character)) != EOF)
+    {
+        symbol_frequency_table[symbol]++;
+    }
+}
+
+
+// Read the next symbol of the content: the symbol of the pair starting at the next character if it has one, otherwise the character.
+// *p_next_character is the character read ahead (initialized with fgetc()). Returns the symbol or EOF at the end of the file.
+int readPairSymbol(FILE *fp_in_file, short int *pair_symbols, int *p_next_character)
+{
+    int character = *p_next_character;
+    int symbol;
+
+    if (character == EOF)
+    {
+        return EOF;
+    }
+
+    // Pairs are taken greedily from left to right, e.g. "the" with the pairs "th" and "he" is split into "th" and 'e'
+    *p_next_character = fgetc(fp_in_file);
+    if (*p_next_character != EOF && (symbol = pair_symbols[character << CHAR_BIT | *p_next_character]) != -1)
+    {
+        *p_next_character = fgetc(fp_in_file);
+        return symbol;
+    }
+
+    return character;
+}
+
+
 // Create a priority queue from a frequency table (priority queue where Huffman tree nodes are sorted by their character's frequency).
-// Returns the head of the queue or NULL if unsuccessful.
-priority_queue_element *frequencyTableToPriorityQueue(int *frequency_table)
+// Returns 0 if successful and -1 if unsuccessful.
+int frequencyTableToPriorityQueue(int *frequency_table, int num_symbols, node_heap *priority_queue)
 {
-    priority_queue_element *priority_queue = NULL; // queue where Huffman tree nodes are sorted by their character's frequency
+    int num_leaves = 0;
+    node *leaf;
+
+    for (int i = 0; i < num_symbols; i++)
+    {
+        num_leaves += frequency_table[i] != 0;
+    }
+    if (initNodeHeap(priority_queue, num_leaves) == -1)
+    {
+        return -1;
+    }
 
     // For every character that is encountered atleast once
-    for (int i = 0; i < NUM_ASCII; i++)
+    for (int i = 0; i < num_symbols; i++)
     {
         if (frequency_table[i])
         {
             // Add a new element to the queue that contains a tree node of that character and the character's frequency
-            if (insertIntoPriorityQueue(&priority_queue, (char)(i), frequency_table[i], NULL, NULL) == -1)
+            if ((leaf = createNode(i, frequency_table[i], NULL, NULL)) == NULL || pushNodeHeap(priority_queue, leaf) == -1)
             {
                 printf("Failed to create the priority queue from the frequency table!\n");
-                freePriorityQueue(&priority_queue);
-                return NULL;
+                free(leaf);
+                freeNodeHeap(priority_queue);
+                return -1;
             }
         }
     }
 
-    return priority_queue;
+    return 0;
 }
 
 
 // Transform a priority queue into a Huffman tree and free the memory used by the queue. Returns the root of the tree or NULL if unsuccesful.
-node *priorityQueueToHuffmanTree(priority_queue_element **p_priority_queue)
+node *priorityQueueToHuffmanTree(node_heap *priority_queue)
 {
-    node *node1 = NULL, *node2 = NULL;
+    node *node1 = NULL, *node2 = NULL, *parent = NULL;
     
     // Sum all elements in the queue
     while (1)
     {
         // Pop the first two elements in the priority queue
-        node1 = popPriorityQueue(p_priority_queue);
-        node2 = popPriorityQueue(p_priority_queue);
+        node1 = popNodeHeap(priority_queue);
+        node2 = popNodeHeap(priority_queue);
 
         // If there was only one remaining element in the queue, return its tree node which is going to be the root of the Huffman tree.
         if (node2 == NULL)
         {
+            freeNodeHeap(priority_queue);
             return node1;
         }
 
         // Add a new element to priority_queue which is a parent to the first two and its node frequency is the sum of the two.
-        if (insertIntoPriorityQueue(p_priority_queue, '\0', node1->frequency + node2->frequency, node1, node2) == -1)
+        // (Two elements were popped, so there is room for it)
+        parent = createNode('\0', node1->frequency + node2->frequency, node1, node2);
+        if (parent == NULL)
         {
             printf("Failed to create the Hufman tree from the priority queue!\n");
-            freePriorityQueue(p_priority_queue);
+            freeBinaryTree(node1);
+            freeBinaryTree(node2);
+            freeNodeHeap(priority_queue);
             return NULL;
         }
+        pushNodeHeap(priority_queue, parent);
     }
 }
 
 
 // Recursively traverse the Huffman tree and encode characters and store their binary representation (path in the tree) in encoded_characters_table.
 // Returns the total number of nodes in the tree, which is saved in the header of the compressed file, so that the tree can be reconstructed when decoding.
-unsigned short int populateEncodedCharactersTable(node *root, int tree_level,
-        char encoded_characters_table[NUM_ASCII][MAX_ENCODED_CHARACTER_LENGTH])
+// buf_character_code keeps track of the path in the tree to the character (which is how the character is encoded).
+unsigned short int populateEncodedCharactersTable(node *root, int tree_level, char *buf_character_code,
+        char encoded_characters_table[][MAX_ENCODED_CHARACTER_LENGTH])
 {
-    static char buf_character_code[MAX_ENCODED_CHARACTER_LENGTH] = {'\0'}; // Keeps track of the path in the tree to the character (which is how the character is encoded).
     unsigned short int num_nodes = 0; // total number of nodes in the tree
 
     if (root)
@@ -192,55 +440,180 @@ unsigned short int populateEncodedCharactersTable(node *root, int tree_level,
 
         // Write 0 to the path to the leaf when going to the left subtree
         buf_character_code[tree_level] = '0';
-        num_nodes += populateEncodedCharactersTable(root->left, tree_level + 1, encoded_characters_table);
+        num_nodes += populateEncodedCharactersTable(root->left, tree_level + 1, buf_character_code, encoded_characters_table);
 
         // Write 1 to the path to the leaf when going to the right subtree
         buf_character_code[tree_level] = '1';
-        num_nodes += populateEncodedCharactersTable(root->right, tree_level + 1, encoded_characters_table);
+        num_nodes += populateEncodedCharactersTable(root->right, tree_level + 1, buf_character_code, encoded_characters_table);
 
         if (root->left == NULL && root->right == NULL)
         {
             // The characters are stored in the leaves. Store the path to the leaf in the coresponding row of encoded_characters_table. 
             // E.g. encoded_characters_table['a'] = "001"
             buf_character_code[tree_level] = '\0';
-            strcpy(encoded_characters_table[(int)root->character], buf_character_code);
-            printf("Character:%c, Encoded:%s\n", root->character, buf_character_code);
+            strcpy(encoded_characters_table[root->character], buf_character_code);
         }
     }
 
     return num_nodes;
 }
 
+
+// Print the Huffman code of every character that is encountered in the input file
+void printEncodedCharactersTable(char encoded_characters_table[NUM_ASCII][MAX_ENCODED_CHARACTER_LENGTH])
+{
+    for (int i = 0; i < NUM_ASCII; i++)
+    {
+        if (encoded_characters_table[i][0] != '\0')
+        {
+            printf("Character:%c, Encoded:%s\n", (char)(i), encoded_characters_table[i]);
+        }
+    }
+}
+
+
+// Print the Huffman code of every character and pair of a BLOCK_TYPE_PAIRS block
+void printEncodedPairsTable(encoder_context *context)
+{
+    for (int i = 0; i < NUM_SYMBOLS; i++)
+    {
+        if (context->encoded_symbols_table[i][0] == '\0')
+        {
+            continue;
+        }
+        if (i < NUM_ASCII)
+        {
+            printf("Character:%c, Encoded:%s\n", (char)(i), context->encoded_symbols_table[i]);
+        }
+        else
+        {
+            printf("Pair:%c%c, Encoded:%s\n", context->pairs[i - NUM_ASCII][0], context->pairs[i - NUM_ASCII][1],
+                   context->encoded_symbols_table[i]);
+        }
+    }
+}
+
+
+/*
+*  Choose how the content is stored using only the frequency table and the Huffman codes:
+*  BLOCK_TYPE_RUN if there is only one distinct character, BLOCK_TYPE_RAW if encoding would not make the file smaller
+*  (e.g. already compressed data, where every character is almost equally frequent) and BLOCK_TYPE_HUFFMAN otherwise.
+*/
+unsigned char chooseBlockType(node *root, unsigned short int tree_size, long in_file_size, int *frequency_table,
+        char encoded_characters_table[NUM_ASCII][MAX_ENCODED_CHARACTER_LENGTH])
+{
+    // An empty file has no tree, there is nothing to encode
+    if (root == NULL)
+    {
+        return BLOCK_TYPE_RAW;
+    }
+
+    // If the root is a leaf, the file is a single character repeated and its code would be empty
+    if (root->left == NULL && root->right == NULL)
+    {
+        return BLOCK_TYPE_RUN;
+    }
+
+    if (huffmanContentSize(tree_size, CHAR_BIT, frequency_table, encoded_characters_table, NUM_ASCII) >= in_file_size)
+    {
+        return BLOCK_TYPE_RAW;
+    }
+
+    return BLOCK_TYPE_HUFFMAN;
+}
+
+
+// Size in bytes of Huffman encoded content: the size of the tree, the serialized tree with symbol_bits per leaf and the codes of every symbol
+long huffmanContentSize(unsigned short int tree_size, int symbol_bits, int *frequency_table,
+        char encoded_characters_table[][MAX_ENCODED_CHARACTER_LENGTH], int num_symbols)
+{
+    long encoded_bits; // size of the serialized tree and the encoded content in bits
+
+    // The serialized tree has a bit for every node and a symbol for every leaf (a tree with n nodes has (n + 1) / 2 leaves)
+    encoded_bits = tree_size + (long)(tree_size + 1) / 2 * symbol_bits;
+    // Every symbol in the content takes as many bits as its Huffman code is long
+    for (int i = 0; i < num_symbols; i++)
+    {
+        if (frequency_table[i])
+        {
+            encoded_bits += (long)frequency_table[i] * (long)strlen(encoded_characters_table[i]);
+        }
+    }
+
+    return (long)sizeof(tree_size) + (encoded_bits + CHAR_BIT - 1) / CHAR_BIT;
+}
+
 /*
 *  Write the header of the compressed file, needed when decoding it,
-*  includes the size of the input file, the size of the Huffman tree and the serialized Huffman tree.
+*  includes the size of the input file, the block type and depending on it
+*  the size of the Huffman tree and the serialized Huffman tree (BLOCK_TYPE_HUFFMAN), the repeated character (BLOCK_TYPE_RUN)
+*  the chosen pairs followed by the size of the Huffman tree and the serialized Huffman tree (BLOCK_TYPE_PAIRS)
+*  or the distance back to the block with the Huffman tree (BLOCK_TYPE_REUSE and BLOCK_TYPE_INDEX).
 *  Returns EOF if unsucessful.
 */
-int writeHeader(FILE *fp_out_file, long in_file_size, unsigned short int tree_size, node *root)
+int writeHeader(bit_writer *writer, long in_file_size, unsigned char block_type, unsigned short int tree_size, node *root,
+                unsigned char pairs[MAX_PAIR_SYMBOLS][2], unsigned short int num_pairs, long codebook_distance)
 {
+    FILE *fp_out_file = writer->fp_out_file;
+
     if ((fwrite(&in_file_size, sizeof(in_file_size), 1, fp_out_file) != 1) ||
-        (fwrite(&tree_size, sizeof(tree_size), 1, fp_out_file) != 1) ||
-        writeSerializedHuffmanTreeToFile(root, fp_out_file) == EOF)
+        (fwrite(&block_type, sizeof(block_type), 1, fp_out_file) != 1))
     {
         return EOF;
     }
 
+    if (block_type == BLOCK_TYPE_HUFFMAN)
+    {
+        if ((fwrite(&tree_size, sizeof(tree_size), 1, fp_out_file) != 1) ||
+            writeSerializedHuffmanTreeToFile(root, CHAR_BIT, writer) == EOF)
+        {
+            return EOF;
+        }
+    }
+    else if (block_type == BLOCK_TYPE_PAIRS)
+    {
+        // The decoder needs the characters of every pair symbol before the tree
+        if ((fwrite(&num_pairs, sizeof(num_pairs), 1, fp_out_file) != 1) ||
+            (fwrite(pairs, 2, num_pairs, fp_out_file) != num_pairs) ||
+            (fwrite(&tree_size, sizeof(tree_size), 1, fp_out_file) != 1) ||
+            writeSerializedHuffmanTreeToFile(root, PAIR_SYMBOL_BITS, writer) == EOF)
+        {
+            return EOF;
+        }
+    }
+    else if (block_type == BLOCK_TYPE_REUSE || block_type == BLOCK_TYPE_INDEX)
+    {
+        // A distance instead of an offset, so that concatenated .huff files still decode
+        if (fwrite(&codebook_distance, sizeof(codebook_distance), 1, fp_out_file) != 1)
+        {
+            return EOF;
+        }
+    }
+    else if (block_type == BLOCK_TYPE_RUN)
+    {
+        // The root of the tree is the only leaf and holds the repeated character
+        if (fputc(root->character, fp_out_file) == EOF)
+        {
+            return EOF;
+        }
+    }
+
     return 0;
 }
 
 
-// Recursively traverse the Huffman tree and write it as serialized into a file. Returns EOF if unsucessful.
-int writeSerializedHuffmanTreeToFile(node *root, FILE *fp_out_file)
+// Recursively traverse the Huffman tree and write it as serialized into a file, symbol_bits for every leaf's character. Returns EOF if unsucessful.
+int writeSerializedHuffmanTreeToFile(node *root, int symbol_bits, bit_writer *writer)
 {
     if (root)
     {
-        writeSerializedHuffmanTreeToFile(root->left, fp_out_file);
-        writeSerializedHuffmanTreeToFile(root->right, fp_out_file);
+        writeSerializedHuffmanTreeToFile(root->left, symbol_bits, writer);
+        writeSerializedHuffmanTreeToFile(root->right, symbol_bits, writer);
 
         if (root->left == NULL && root->right == NULL)
         {
             // The characters are stored in the leaves. For a leaf write 1 followed by its character
-            if ((writeBitToFile(fp_out_file, 1) == EOF) || writeCharToFile(fp_out_file, root->character) == EOF)
+            if ((writeBitToFile(writer, 1) == EOF) || writeBitsToFile(writer, root->character, symbol_bits) == EOF)
             {
                 return EOF;
             }
@@ -248,7 +621,7 @@ int writeSerializedHuffmanTreeToFile(node *root, FILE *fp_out_file)
         else
         {
             // For a parent node write 0
-            if (writeBitToFile(fp_out_file, 0) == EOF)
+            if (writeBitToFile(writer, 0) == EOF)
             {
                 return EOF;
             }
@@ -258,18 +631,20 @@ int writeSerializedHuffmanTreeToFile(node *root, FILE *fp_out_file)
 }
 
 
-// Encode a file using the Huffman tree built from it. Returns EOF if unsucessful.
-int writeEncodedFileContent(char encoded_characters_table[NUM_ASCII][MAX_ENCODED_CHARACTER_LENGTH], FILE *fp_in_file,
-                            FILE *fp_out_file)
+// Encode a file using the Huffman tree built from it. The content is split into characters and pairs if pair_symbols is not NULL.
+// Returns EOF if unsucessful.
+int writeEncodedFileContent(char encoded_characters_table[][MAX_ENCODED_CHARACTER_LENGTH], short int *pair_symbols, FILE *fp_in_file,
+                            bit_writer *writer)
 {
     int character;  // fgetc returns an int so that it can represent every character and EOF
+    int next_character = pair_symbols ? fgetc(fp_in_file) : EOF;  // the character read ahead by readPairSymbol()
 
     // Write the encoding of each character into the compressed file.
-    while ((character = fgetc(fp_in_file)) != EOF)
+    while ((character = pair_symbols ? readPairSymbol(fp_in_file, pair_symbols, &next_character) : fgetc(fp_in_file)) != EOF)
     {
         for (int i = 0, len = strlen(encoded_characters_table[character]); i < len; i++)
         {
-            if (writeBitToFile(fp_out_file, encoded_characters_table[character][i] - '0') == EOF)
+            if (writeBitToFile(writer, encoded_characters_table[character][i] - '0') == EOF)
             {
                 return EOF;
             }
@@ -279,7 +654,7 @@ int writeEncodedFileContent(char encoded_characters_table[NUM_ASCII][MAX_ENCODED
     // Write seven 0 bits to make sure the last byte is complete.
     for (int i = 0; i < CHAR_BIT - 1; i++)
     {
-        if (writeBitToFile(fp_out_file, 0) == EOF)
+        if (writeBitToFile(writer, 0) == EOF)
         {
             printf("Failed to write the last byte!\n");
             return EOF;
@@ -290,13 +665,32 @@ int writeEncodedFileContent(char encoded_characters_table[NUM_ASCII][MAX_ENCODED
 }
 
 
-// Write a char bit by bit using writeBitToFile(). Returns EOF if unsucessful.
-int writeCharToFile(FILE *fp_out_file, char byte)
+// Copy the content of the input file as it is into the output file. Returns EOF if unsucessful.
+int writeRawFileContent(FILE *fp_in_file, FILE *fp_out_file)
+{
+    char buffer[COPY_BUFFER_SIZE];
+    size_t bytes_read;
+
+    while ((bytes_read = fread(buffer, 1, sizeof(buffer), fp_in_file)) > 0)
+    {
+        if (fwrite(buffer, 1, bytes_read, fp_out_file) != bytes_read)
+        {
+            printf("Failed to copy the content to the output file!\n");
+            return EOF;
+        }
+    }
+
+    return ferror(fp_in_file) ? EOF : 0;
+}
+
+
+// Write the num_bits lowest bits of value bit by bit using writeBitToFile(). Returns EOF if unsucessful.
+int writeBitsToFile(bit_writer *writer, int value, int num_bits)
 {
     // Need to write it bit by bit so that it doesn't get saved to the file before some other bits that have not filled a byte yet.
-    for (int j = CHAR_BIT - 1; j >= 0; j--)
+    for (int j = num_bits - 1; j >= 0; j--)
     {
-        if (writeBitToFile(fp_out_file, (byte >> j) & 1) == EOF)
+        if (writeBitToFile(writer, (value >> j) & 1) == EOF)
         {
             return EOF;
         }
@@ -306,26 +700,23 @@ int writeCharToFile(FILE *fp_out_file, char byte)
 
 
 // After CHAR_BIT (8) bits have been accumulated, write a byte to the file. Returns EOF if unsucessful.
-int writeBitToFile(FILE *fp_out_file, char bit)
+int writeBitToFile(bit_writer *writer, char bit)
 {
-    static unsigned char byte = 0;  // The byte written to the file
-    static short int bits_written = 0;  // number of bits written so far
-
     // Add the new bit to the other bits of the previous calls of the function.
-    byte = (byte << 1) | bit;
-    bits_written++;
+    writer->byte = (writer->byte << 1) | bit;
+    writer->bits_written++;
 
     // We can't write an individual bit to a file, but rather a whole byte.
-    if (bits_written == CHAR_BIT)
+    if (writer->bits_written == CHAR_BIT)
     {
-        if (fputc(byte, fp_out_file) == EOF)
+        if (fputc(writer->byte, writer->fp_out_file) == EOF)
         {
             printf("Failed to write a byte to the output file!");
             return EOF;
         }
 
-        bits_written = 0;
-        byte = 0;
+        writer->bits_written = 0;
+        writer->byte = 0;
     }
 
     return 0;
@@ -1,47 +1,172 @@
+/*
+ * Data structures, macros and function declarations
+ * used for encoding
+*/
+
+
+#ifndef ENCODE_H
+#define ENCODE_H
+
 #include "common.h"
 
 
-// Number of ASCII characters. Used to determine the size of frequency_table and encoded_characters_table
-#define NUM_ASCII 256
 // Max length of the huffman code for a single character
 // (probably can be optimized)
 #define MAX_ENCODED_CHARACTER_LENGTH 64
+// Files larger than this are split into blocks that are encoded in parallel, each with its own Huffman tree
+#define MAX_BLOCK_SIZE (1L << 20)
+// Number of symbols of a BLOCK_TYPE_PAIRS block: the characters followed by the pairs. Used to determine the size of the symbol tables.
+#define NUM_SYMBOLS (NUM_ASCII + MAX_PAIR_SYMBOLS)
+// Number of possible pairs of characters. Used to determine the size of the pair tables.
+#define NUM_PAIRS (NUM_ASCII * NUM_ASCII)
+// A pair must be encountered at least this many times to get its own symbol (its symbol takes PAIR_SYMBOL_BITS + 1 bits in the tree and 2 bytes in the header)
+#define PAIR_MIN_FREQUENCY 8
+
+
+struct codebook_cache;  // codebook_cache.h
+struct codebook;
+
+
+// Tables used for encoding a file and the results of encoding it. The same context can be reused for encoding many files.
+typedef struct encoder_context
+{
+    struct codebook_cache *cache;  // Codebooks reused for files with similar frequency tables or NULL
+    int frequency_table[NUM_ASCII]; // How many times each character is encountered in the file. E.g. frequency_table['a'] = 3
+    /*
+    * Table to store characters and their Huffman binary codes.
+    * First dimension corresponds to ASCII character, second dimension is the encoded character (the path in the Huffman tree).
+    * e.g. encoded_characters_table['a'] = "001"
+    * This table is used because otherwise would have to blindly traverse the tree for every character when encoding the input file.
+    * ( In the future might dynamically allocate memory for every character according to its depth in the tree
+    * instead of using a predetermined second dimension of size MAX_ENCODED_CHARACTER_LENGTH )
+    */
+    char encoded_characters_table[NUM_ASCII][MAX_ENCODED_CHARACTER_LENGTH];
+    long in_file_size; // size of the input file - how many characters it contains
+    unsigned char block_type; // how the content is stored in the compressed file (BLOCK_TYPE_HUFFMAN, BLOCK_TYPE_RAW, BLOCK_TYPE_RUN or BLOCK_TYPE_PAIRS)
+
+    // Tables used only if use_pairs is set, for coding frequent pairs of characters as single symbols (BLOCK_TYPE_PAIRS)
+    int use_pairs;  // also try BLOCK_TYPE_PAIRS and use it if it makes the file smaller
+    int pair_frequency_table[NUM_PAIRS];  // How many times each pair of adjacent characters is encountered. E.g. pair_frequency_table['t' << 8 | 'h'] = 5
+    short int pair_symbols[NUM_PAIRS];  // The symbol of every chosen pair or -1. E.g. pair_symbols['t' << 8 | 'h'] = NUM_ASCII
+    unsigned char pairs[MAX_PAIR_SYMBOLS][2];  // The characters of the chosen pairs, symbol NUM_ASCII + i is pairs[i]
+    unsigned short int num_pairs;  // number of chosen pairs
+    int symbol_frequency_table[NUM_SYMBOLS];  // How many times each symbol is encountered when the content is split into symbols
+    char encoded_symbols_table[NUM_SYMBOLS][MAX_ENCODED_CHARACTER_LENGTH];  // Huffman codes of the symbols
+
+    // Used only if reuse_codebook is set, when blocks are appended to a compressed file (BLOCK_TYPE_REUSE)
+    int reuse_codebook;  // blocks may refer to the Huffman tree of an earlier block of the output file instead of carrying their own
+    long reuse_offset;  // offset of the latest BLOCK_TYPE_HUFFMAN block in the output file or -1
+    char reused_characters_table[NUM_ASCII][MAX_ENCODED_CHARACTER_LENGTH];  // Huffman codes of the block at reuse_offset
+} encoder_context;
+
+// Accumulates bits until a whole byte can be written to the output file
+typedef struct bit_writer
+{
+    FILE *fp_out_file;
+    unsigned char byte;  // The byte written to the file
+    short int bits_written;  // number of bits written so far
+} bit_writer;
+
+// A pair of characters that may get its own symbol, sorted by frequency when the symbols are chosen
+typedef struct pair_candidate
+{
+    int pair;  // the first character << 8 | the second character
+    int frequency;
+} pair_candidate;
+
+
+// Encode the content of fp_in_file into fp_out_file as a single block using the tables of context.
+// Returns 0 if successful or one of the error codes in common.h.
+int encodeFile(FILE *fp_in_file, FILE *fp_out_file, encoder_context *context);
 
+// Free the Huffman tree after encoding a file or give it back to the cache if it is owned by a cached codebook
+void releaseHuffmanTree(encoder_context *context, struct codebook *book, node *root);
 
-// Create a Huffman tree from file content. Returns tree root or NULL if unsuccessful.
-node *createHuffmanTree(FILE *fp_in_file);
+
+// Create a Huffman tree from a frequency table of num_symbols symbols. Returns tree root or NULL if unsuccessful or if the table is empty.
+node *createHuffmanTree(int *frequency_table, int num_symbols);
+
+// Choose the pairs of characters coded as single symbols, count the symbols and create their Huffman tree (BLOCK_TYPE_PAIRS).
+// *p_tree_size is set to the number of nodes in the tree. Returns tree root or NULL if unsuccessful or if no pair is frequent enough.
+node *createPairHuffmanTree(FILE *fp_in_file, encoder_context *context, unsigned short int *p_tree_size);
 
 // Populate a frequency table for a given file's content (how many times each character is encountered in the file)
 void populateFrequencyTable(FILE *fp_in_file, int *frequency_table);
 
+// Populate a frequency table of the pairs of adjacent characters in a given file's content (how many times each pair is encountered in the file)
+void populatePairFrequencyTable(FILE *fp_in_file, int *pair_frequency_table);
+
+// Give a symbol to the most frequent pairs (at most MAX_PAIR_SYMBOLS, each encountered at least PAIR_MIN_FREQUENCY times).
+// Returns the number of chosen pairs.
+unsigned short int choosePairSymbols(int *pair_frequency_table, short int *pair_symbols, unsigned char pairs[MAX_PAIR_SYMBOLS][2]);
+
+// Sort pair candidates by decreasing frequency (used by qsort)
+int comparePairCandidates(const void *a, const void *b);
+
+// Populate a frequency table of the symbols a given file's content is split into by readPairSymbol()
+void populateSymbolFrequencyTable(FILE *fp_in_file, short int *pair_symbols, int *symbol_frequency_table);
+
+// Read the next symbol of the content: the symbol of the pair starting at the next character if it has one, otherwise the character.
+// *p_next_character is the character read ahead (initialized with fgetc()). Returns the symbol or EOF at the end of the file.
+int readPairSymbol(FILE *fp_in_file, short int *pair_symbols, int *p_next_character);
+
 // Create a priority queue from a frequency table (priority queue where Huffman tree nodes are sorted by their character's frequency).
-// Returns the head of the queue or NULL if unsuccessful.
-priority_queue_element *frequencyTableToPriorityQueue(int *frequency_table);
+// Returns 0 if successful and -1 if unsuccessful.
+int frequencyTableToPriorityQueue(int *frequency_table, int num_symbols, node_heap *priority_queue);
 
 // Transform a priority queue into a Huffman tree and free the memory used by the queue. Returns the root of the tree or NULL if unsuccesful.
-node *priorityQueueToHuffmanTree(priority_queue_element **p_priority_queue);
+node *priorityQueueToHuffmanTree(node_heap *priority_queue);
 
 // Recursively traverse the Huffman tree and encode characters and store their binary representation (path in the tree) in encoded_characters_table.
 // Returns the total number of nodes in the tree, which is saved in the header of the compressed file, so that the tree can be reconstructed when decoding.
-unsigned short int populateEncodedCharactersTable(node *root, int tree_level,
+// buf_character_code keeps track of the path in the tree to the character (which is how the character is encoded).
+unsigned short int populateEncodedCharactersTable(node *root, int tree_level, char *buf_character_code,
+        char encoded_characters_table[][MAX_ENCODED_CHARACTER_LENGTH]);
+
+// Print the Huffman code of every character that is encountered in the input file
+void printEncodedCharactersTable(char encoded_characters_table[NUM_ASCII][MAX_ENCODED_CHARACTER_LENGTH]);
+
+// Print the Huffman code of every character and pair of a BLOCK_TYPE_PAIRS block
+void printEncodedPairsTable(encoder_context *context);
+
+/*
+*  Choose how the content is stored using only the frequency table and the Huffman codes:
+*  BLOCK_TYPE_RUN if there is only one distinct character, BLOCK_TYPE_RAW if encoding would not make the file smaller
+*  (e.g. already compressed data, where every character is almost equally frequent) and BLOCK_TYPE_HUFFMAN otherwise.
+*/
+unsigned char chooseBlockType(node *root, unsigned short int tree_size, long in_file_size, int *frequency_table,
         char encoded_characters_table[NUM_ASCII][MAX_ENCODED_CHARACTER_LENGTH]);
 
+// Size in bytes of Huffman encoded content: the size of the tree, the serialized tree with symbol_bits per leaf and the codes of every symbol
+long huffmanContentSize(unsigned short int tree_size, int symbol_bits, int *frequency_table,
+        char encoded_characters_table[][MAX_ENCODED_CHARACTER_LENGTH], int num_symbols);
+
 /*
 *  Write the header of the compressed file, needed when decoding it,
-*  includes the size of the input file, the size of the Huffman tree and the serialized Huffman tree.
+*  includes the size of the input file, the block type and depending on it
+*  the size of the Huffman tree and the serialized Huffman tree (BLOCK_TYPE_HUFFMAN), the repeated character (BLOCK_TYPE_RUN)
+*  the chosen pairs followed by the size of the Huffman tree and the serialized Huffman tree (BLOCK_TYPE_PAIRS)
+*  or the distance back to the block with the Huffman tree (BLOCK_TYPE_REUSE and BLOCK_TYPE_INDEX).
 *  Returns EOF if unsucessful.
 */
-int writeHeader(FILE *fp_out_file, long in_file_size, unsigned short int tree_size, node *root);
+int writeHeader(bit_writer *writer, long in_file_size, unsigned char block_type, unsigned short int tree_size, node *root,
+                unsigned char pairs[MAX_PAIR_SYMBOLS][2], unsigned short int num_pairs, long codebook_distance);
+
+// Recursively traverse the Huffman tree and write it as serialized into a file, symbol_bits for every leaf's character. Returns EOF if unsucessful.
+int writeSerializedHuffmanTreeToFile(node *root, int symbol_bits, bit_writer *writer);
 
-// Recursively traverse the Huffman tree and write it as serialized into a file. Returns EOF if unsucessful.
-int writeSerializedHuffmanTreeToFile(node *root, FILE *fp_out_file);
+// Encode a file using the Huffman tree built from it. The content is split into characters and pairs if pair_symbols is not NULL.
+// Returns EOF if unsucessful.
+int writeEncodedFileContent(char encoded_characters_table[][MAX_ENCODED_CHARACTER_LENGTH], short int *pair_symbols, FILE *fp_in_file,
+                            bit_writer *writer);
 
-// Encode a file using the Huffman tree built from it. Returns EOF if unsucessful.
-int writeEncodedFileContent(char encoded_characters_table[NUM_ASCII][MAX_ENCODED_CHARACTER_LENGTH], FILE *fp_in_file,
-                            FILE *fp_out_file);
+// Copy the content of the input file as it is into the output file. Returns EOF if unsucessful.
+int writeRawFileContent(FILE *fp_in_file, FILE *fp_out_file);
 
 // After CHAR_BIT (8) bits have been accumulated, write a byte to the file. Returns EOF if unsucessful.
-int writeBitToFile(FILE *fp_out_file, char bit);
+int writeBitToFile(bit_writer *writer, char bit);
+
+// Write the num_bits lowest bits of value bit by bit using writeBitToFile(). Returns EOF if unsucessful.
+int writeBitsToFile(bit_writer *writer, int value, int num_bits);
 
-// Write a char bit by bit using writeBitToFile(). Returns EOF if unsucessful.
-int writeCharToFile(FILE *fp_out_file, char byte);
\ No newline at end of file
+#endif
\ No newline at end of file
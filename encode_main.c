@@ -0,0 +1,98 @@
+/*
+ * Encode files using Huffman coding
+ * Usage: ./encode [-j threads] [-p] <file or directory>...
+ *        ./encode -a <huff file> [-p] <file>...
+ *        ./encode -s [-p] < <file> > <huff file>
+*/
+
+#define _DEFAULT_SOURCE
+
+#include <unistd.h>
+#include "batch.h"
+#include "append.h"
+#include "stream.h"
+
+
+int main(int argc, char *argv[])
+{
+    static batch files;  // Files that will be compressed, each into <name>.huff
+    long num_workers = sysconf(_SC_NPROCESSORS_ONLN);  // Number of threads encoding the files
+    char *append_file_name = NULL;  // The compressed file that the files are appended to instead (-a)
+    int use_stream = 0;  // Encode stdin into stdout as it arrives instead (-s)
+    int option;
+    int result;
+
+    initBatch(&files, BATCH_ENCODE);
+
+    while ((option = getopt(argc, argv, "j:pa:s")) != -1)
+    {
+        if (option == 'a')
+        {
+            append_file_name = optarg;
+            continue;
+        }
+        if (option == 's')
+        {
+            use_stream = 1;
+            continue;
+        }
+        if (option == 'j' && (num_workers = strtol(optarg, NULL, 10)) > 0)
+        {
+            continue;
+        }
+        if (option == 'p')
+        {
+            // Code frequent pairs of characters as single symbols when it makes a block smaller
+            files.use_pairs = 1;
+            continue;
+        }
+        printf("Usage: %s [-j threads] [-p] <file or directory>...\n       %s -a <huff file> [-p] <file>...\n       %s -s [-p] < <file> > <huff file>\n",
+               argv[0], argv[0], argv[0]);
+        freeBatch(&files);
+        return INVALID_FILE_NAME;
+    }
+    // Encode a pipe or a socket chunk by chunk, the blocks are written as soon as they are complete
+    if (use_stream)
+    {
+        freeBatch(&files);
+        return streamEncodeFile(STDIN_FILENO, STDOUT_FILENO, files.use_pairs);
+    }
+    if (optind == argc)
+    {
+        printf("Usage: %s [-j threads] [-p] <file or directory>...\n       %s -a <huff file> [-p] <file>...\n       %s -s [-p] < <file> > <huff file>\n",
+               argv[0], argv[0], argv[0]);
+        freeBatch(&files);
+        return INVALID_FILE_NAME;
+    }
+
+    // Add new blocks to the end of an existing compressed file without re-encoding it
+    if (append_file_name)
+    {
+        result = appendFiles(append_file_name, argv + optind, argc - optind, files.use_pairs);
+        freeBatch(&files);
+        return result;
+    }
+    if (num_workers < 1)
+    {
+        num_workers = 1;
+    }
+
+    // Get the names of the files that will be compressed from the CLA, directories are searched recursively
+    for (int i = optind; i < argc; i++)
+    {
+        result = addBatchPath(&files, argv[i], 0);
+        if (result != 0)
+        {
+            freeBatch(&files);
+            return result;
+        }
+    }
+
+    // The Huffman codes are printed only when a single file is encoded
+    files.print_codes = files.num_files == 1;
+
+    result = runBatch(&files, num_workers);
+    freeBatch(&files);
+
+    return result;
+}
@@ -0,0 +1,181 @@
+/*
+ * Client of the compression daemon (./huffd)
+ * Usage: ./huffc [-s <socket path>] encode|decode [<input file> <output file>]
+ *        ./huffc [-s <socket path>] stats
+ * Without file names the input is read from stdin, sent inline and the result is written to stdout.
+ * With file names the daemon gets the file descriptors of the files and reads and writes them directly.
+*/
+
+#define _DEFAULT_SOURCE  // getopt() is not part of C99
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "common.h"
+#include "huffd.h"
+
+
+// Read everything from stdin. Returns the data (which must be freed) or NULL if unsuccessful.
+char *readStandardInput(long *size);
+
+
+int main(int argc, char *argv[])
+{
+    const char *socket_path = HUFFD_SOCKET_PATH;
+    huffd_request request = {0};
+    huffd_response response;
+    struct sockaddr_un address = {0};
+    char *data = NULL;  // inline input and output
+    int socket_fd, in_fd = -1, out_fd = -1;
+    int option;
+
+    while ((option = getopt(argc, argv, "s:")) != -1)
+    {
+        if (option == 's' && strlen(optarg) < sizeof(address.sun_path))
+        {
+            socket_path = optarg;
+        }
+        else
+        {
+            optind = argc + 1;  // print the usage
+            break;
+        }
+    }
+
+    if (optind < argc && strcmp(argv[optind], "encode") == 0)
+    {
+        request.operation = HUFFD_ENCODE;
+    }
+    else if (optind < argc && strcmp(argv[optind], "decode") == 0)
+    {
+        request.operation = HUFFD_DECODE;
+    }
+    else if (optind < argc && strcmp(argv[optind], "stats") == 0)
+    {
+        request.operation = HUFFD_STATS;
+    }
+
+    if (request.operation == 0 || (argc - optind != 1 && argc - optind != 3) || (request.operation == HUFFD_STATS && argc - optind != 1))
+    {
+        printf("Usage: %s [-s <socket path>] encode|decode [<input file> <output file>]\n", argv[0]);
+        printf("       %s [-s <socket path>] stats\n", argv[0]);
+        return INVALID_FILE_NAME;
+    }
+
+    // Pass the files to the daemon or read the inline input
+    if (argc - optind == 3)
+    {
+        request.with_fds = 1;
+        in_fd = open(argv[optind + 1], O_RDONLY);
+        if (in_fd == -1)
+        {
+            printf("Failed to open the input file!\n");
+            return FAIL_OPEN_INPUT_FILE;
+        }
+        out_fd = open(argv[optind + 2], O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (out_fd == -1)
+        {
+            printf("Failed to open the output file!\n");
+            close(in_fd);
+            return FAIL_OPEN_OUTPUT_FILE;
+        }
+    }
+    else if (request.operation != HUFFD_STATS)
+    {
+        data = readStandardInput(&request.data_size);
+        if (data == NULL)
+        {
+            printf("Failed to read the input!\n");
+            return FAIL_OPEN_INPUT_FILE;
+        }
+    }
+
+    // The daemon may refuse a request (e.g. if it is too large) and close the connection before all the inline data is sent
+    signal(SIGPIPE, SIG_IGN);
+
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, socket_path);
+    socket_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (socket_fd == -1 || connect(socket_fd, (struct sockaddr *)&address, sizeof(address)) == -1
+        || sendRequest(socket_fd, &request, in_fd, out_fd) == -1
+        || (writeAll(socket_fd, data, request.data_size) == -1 && errno != EPIPE)
+        || readAll(socket_fd, &response, sizeof(response)) == -1)
+    {
+        printf("Failed to send the request to %s!\n", socket_path);
+        free(data);
+        return FAIL_SOCKET;
+    }
+
+    // The daemon has its own copies of the file descriptors
+    if (in_fd != -1)
+    {
+        close(in_fd);
+        close(out_fd);
+    }
+
+    // Copy the inline result to stdout
+    free(data);
+    data = malloc(response.data_size > 0 ? response.data_size : 1);
+    if (data == NULL || readAll(socket_fd, data, response.data_size) == -1
+        || fwrite(data, 1, response.data_size, stdout) != (size_t)response.data_size)
+    {
+        printf("Failed to receive the result!\n");
+        free(data);
+        close(socket_fd);
+        return FAIL_SOCKET;
+    }
+
+    free(data);
+    close(socket_fd);
+
+    if (response.status == FAIL_REQUEST_TOO_LARGE)
+    {
+        printf("The request or its result is larger than the daemon accepts!\n");
+    }
+
+    return response.status;
+}
+
+
+// Read everything from stdin. Returns the data (which must be freed) or NULL if unsuccessful.
+char *readStandardInput(long *size)
+{
+    char *data = NULL, *new_data;
+    size_t capacity = 0;
+    size_t bytes_read;
+
+    *size = 0;
+    do
+    {
+        // Double the buffer when it is full
+        if ((size_t)*size == capacity)
+        {
+            capacity = capacity ? capacity * 2 : COPY_BUFFER_SIZE;
+            new_data = realloc(data, capacity);
+            if (new_data == NULL)
+            {
+                free(data);
+                return NULL;
+            }
+            data = new_data;
+        }
+
+        bytes_read = fread(data + *size, 1, capacity - *size, stdin);
+        *size += bytes_read;
+    }
+    while (bytes_read > 0);
+
+    if (ferror(stdin))
+    {
+        free(data);
+        return NULL;
+    }
+
+    return data;
+}
@@ -0,0 +1,709 @@
+/*
+ * Compression daemon serving encode and decode requests over a Unix domain socket
+ * Usage: ./huffd [-s <socket path>] [-w <number of workers>] [-c <codebook cache file>] [-m <max request size>]
+*/
+
+#define _DEFAULT_SOURCE  // fmemopen(), open_memstream(), sigaction() and getopt() are not part of C99
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include "encode.h"
+#include "decode.h"
+#include "codebook_cache.h"
+#include "huffd.h"
+
+
+// Connections whose next request arrived and is waiting to be served by a worker
+typedef struct connection_queue
+{
+    int fds[HUFFD_QUEUE_LENGTH];
+    int head;  // index of the connection that will be served next
+    int count;  // number of connections waiting
+    int shutting_down;  // set when the workers should exit
+    pthread_mutex_t mutex;
+    pthread_cond_t not_empty, not_full;
+} connection_queue;
+
+// Connections polled by the main thread for their next request.
+// fds[0] is the listening socket and fds[1] the pipe through which the workers give back the connections they served a request of.
+typedef struct poll_set
+{
+    struct pollfd *fds;
+    int count;
+    int capacity;
+} poll_set;
+
+// Latency histograms of the served requests, one for encoding and one for decoding
+typedef struct latency_stats
+{
+    unsigned long histogram[2][HUFFD_LATENCY_BUCKETS];
+    unsigned long requests[2];
+    unsigned long failures[2];
+    pthread_mutex_t mutex;
+} latency_stats;
+
+// A thread serving requests. The context and the buffer stay allocated between requests.
+typedef struct worker
+{
+    pthread_t thread;
+    encoder_context context;
+    char *buffer;  // the input of the current request
+    size_t buffer_capacity;
+} worker;
+
+
+// Serve a request of every connection in the queue and give the connection back to the main thread, until the daemon shuts down
+void *runWorker(void *arg);
+
+// Serve the next request of a client. Returns 1 if the connection can be used for another request and 0 if it must be closed.
+int serveNextRequest(worker *self, int client_fd);
+
+// Encode or decode the input of a request into out_fd or into an inline result. Returns 0 if successful or one of the error codes in common.h.
+int serveRequest(worker *self, int client_fd, const huffd_request *request, int in_fd, int out_fd,
+                 char **result, size_t *result_size);
+
+// Read a request's input (inline data or everything from in_fd, at most max_request_size bytes) into the buffer of the worker.
+// *p_input_size is set to its size. Returns 0 if successful or one of the error codes in common.h.
+int readRequestInput(worker *self, int client_fd, const huffd_request *request, int in_fd, long *p_input_size);
+
+// Wait until fd can be read, at most HUFFD_IO_TIMEOUT seconds. Returns 0 if it can be read and -1 if unsuccessful.
+int waitForInput(int fd);
+
+// Make the buffer of the worker at least capacity bytes big. Returns 0 if successful and -1 if unsuccessful.
+int reserveBuffer(worker *self, size_t capacity);
+
+// Add the latency of a served request to the histograms
+void recordLatency(char operation, const struct timespec *start, int status);
+
+// Print the request counts, latency histograms and codebook cache hits and misses
+void printLatencyStats(FILE *fp_out_file);
+
+// Stop accepting connections on SIGINT and SIGTERM
+void handleStopSignal(int signal_number);
+
+// Add the connection to the queue of the workers, waits while the queue is full
+void queueConnection(int client_fd);
+
+// Give up on a client that stops sending its request or reading its response after HUFFD_IO_TIMEOUT seconds
+void setConnectionTimeouts(int client_fd);
+
+// Add a file descriptor to the polled ones. Returns 0 if successful and -1 if unsuccessful.
+int addToPollSet(poll_set *set, int fd);
+
+// Stop polling the file descriptor at index (the last one takes its place)
+void removeFromPollSet(poll_set *set, int index);
+
+
+static connection_queue queue = {.mutex = PTHREAD_MUTEX_INITIALIZER, .not_empty = PTHREAD_COND_INITIALIZER,
+                                 .not_full = PTHREAD_COND_INITIALIZER};
+static latency_stats stats = {.mutex = PTHREAD_MUTEX_INITIALIZER};
+static volatile sig_atomic_t stop_requested = 0;
+static codebook_cache encoder_cache;  // Codebooks shared by the workers for files with similar frequency tables
+static codebook_cache decoder_cache;  // Reconstructed trees shared by the workers
+static int returned_connections[2] = {-1, -1};  // Pipe through which the workers give back the connections they served a request of
+static long max_request_size = HUFFD_MAX_REQUEST_SIZE;  // Larger requests fail with FAIL_REQUEST_TOO_LARGE
+
+
+int main(int argc, char *argv[])
+{
+    const char *socket_path = HUFFD_SOCKET_PATH;  // where the daemon listens for connections
+    const char *cache_file_name = NULL;  // where the encoder codebooks are kept between runs of the daemon
+    int num_workers = HUFFD_NUM_WORKERS;
+    worker *workers = NULL;
+    poll_set clients = {NULL, 0, 0};  // The listening socket, the pipe of the given back connections and the idle connections
+    struct sockaddr_un address = {0};
+    struct sigaction stop_action = {0};
+    sigset_t stop_signals;
+    int listen_fd, client_fd;
+    int option;
+
+    while ((option = getopt(argc, argv, "s:w:c:m:")) != -1)
+    {
+        if (option == 's' && strlen(optarg) < sizeof(address.sun_path))
+        {
+            socket_path = optarg;
+        }
+        else if (option == 'w' && atoi(optarg) > 0)
+        {
+            num_workers = atoi(optarg);
+        }
+        else if (option == 'c')
+        {
+            cache_file_name = optarg;
+        }
+        else if (option == 'm' && strtol(optarg, NULL, 10) >= 0)
+        {
+            max_request_size = strtol(optarg, NULL, 10);
+        }
+        else
+        {
+            printf("Usage: %s [-s <socket path>] [-w <number of workers>] [-c <codebook cache file>] [-m <max request size>]\n", argv[0]);
+            return INVALID_FILE_NAME;
+        }
+    }
+
+    initCodebookCache(&encoder_cache);
+    initCodebookCache(&decoder_cache);
+    if (cache_file_name && loadCodebookCache(&encoder_cache, cache_file_name) == -1)
+    {
+        printf("Starting with an empty codebook cache, failed to load %s\n", cache_file_name);
+    }
+
+    // Create the socket where the clients connect
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, socket_path);
+    unlink(socket_path);
+    listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd == -1 || bind(listen_fd, (struct sockaddr *)&address, sizeof(address)) == -1 || listen(listen_fd, SOMAXCONN) == -1)
+    {
+        printf("Failed to listen on %s!\n", socket_path);
+        return FAIL_SOCKET;
+    }
+
+    // The main thread never blocks on reading the connections given back by the workers
+    if (pipe(returned_connections) == -1 || fcntl(returned_connections[0], F_SETFL, O_NONBLOCK) == -1
+        || addToPollSet(&clients, listen_fd) == -1 || addToPollSet(&clients, returned_connections[0]) == -1)
+    {
+        printf("Failed to create the pipe of the workers!\n");
+        close(listen_fd);
+        return FAIL_SOCKET;
+    }
+
+    // A client closing its end early must not kill the daemon
+    signal(SIGPIPE, SIG_IGN);
+
+    // Only the main thread handles the stop signals, so that they interrupt poll()
+    sigemptyset(&stop_signals);
+    sigaddset(&stop_signals, SIGINT);
+    sigaddset(&stop_signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stop_signals, NULL);
+
+    workers = calloc(num_workers, sizeof(worker));
+    if (workers == NULL)
+    {
+        printf("Failed to allocate memory for the workers!\n");
+        close(listen_fd);
+        return FAIL_ALLOCATE_MEMORY;
+    }
+    for (int i = 0; i < num_workers; i++)
+    {
+        if (pthread_create(&workers[i].thread, NULL, runWorker, &workers[i]) != 0)
+        {
+            printf("Failed to start a worker!\n");
+            num_workers = i;
+            stop_requested = 1;
+            break;
+        }
+    }
+
+    stop_action.sa_handler = handleStopSignal;  // no SA_RESTART, so poll() returns when a signal arrives
+    sigaction(SIGINT, &stop_action, NULL);
+    sigaction(SIGTERM, &stop_action, NULL);
+    pthread_sigmask(SIG_UNBLOCK, &stop_signals, NULL);
+
+    printf("Listening on %s with %d workers\n", socket_path, num_workers);
+    fflush(stdout);
+
+    // A connection is handed to a worker only when its next request arrives and comes back after the request is served,
+    // so idle clients don't hold the workers
+    while (!stop_requested)
+    {
+        if (poll(clients.fds, clients.count, -1) == -1)
+        {
+            continue;  // interrupted by a stop signal
+        }
+
+        // Removing a connection moves the last one, which was already checked, to its place
+        for (int i = clients.count - 1; i >= 2; i--)
+        {
+            if (clients.fds[i].revents)
+            {
+                client_fd = clients.fds[i].fd;
+                removeFromPollSet(&clients, i);
+                queueConnection(client_fd);
+            }
+        }
+
+        if (clients.fds[0].revents & POLLIN)
+        {
+            client_fd = accept(listen_fd, NULL, NULL);
+            if (client_fd != -1)
+            {
+                setConnectionTimeouts(client_fd);
+                if (addToPollSet(&clients, client_fd) == -1)
+                {
+                    close(client_fd);
+                }
+            }
+        }
+
+        if (clients.fds[1].revents & POLLIN)
+        {
+            while (read(returned_connections[0], &client_fd, sizeof(client_fd)) == sizeof(client_fd))
+            {
+                if (addToPollSet(&clients, client_fd) == -1)
+                {
+                    close(client_fd);
+                }
+            }
+        }
+    }
+
+    // Let the workers finish the queued requests and exit
+    pthread_mutex_lock(&queue.mutex);
+    queue.shutting_down = 1;
+    pthread_cond_broadcast(&queue.not_empty);
+    pthread_mutex_unlock(&queue.mutex);
+    for (int i = 0; i < num_workers; i++)
+    {
+        pthread_join(workers[i].thread, NULL);
+        free(workers[i].buffer);
+    }
+
+    // Close the idle connections and the ones given back while stopping
+    for (int i = 2; i < clients.count; i++)
+    {
+        close(clients.fds[i].fd);
+    }
+    while (read(returned_connections[0], &client_fd, sizeof(client_fd)) == sizeof(client_fd))
+    {
+        close(client_fd);
+    }
+    close(returned_connections[0]);
+    close(returned_connections[1]);
+    free(clients.fds);
+
+    printLatencyStats(stdout);
+
+    if (cache_file_name && saveCodebookCache(&encoder_cache, cache_file_name) == -1)
+    {
+        printf("Failed to save the codebook cache to %s!\n", cache_file_name);
+    }
+    freeCodebookCache(&encoder_cache);
+    freeCodebookCache(&decoder_cache);
+
+    close(listen_fd);
+    unlink(socket_path);
+    free(workers);
+
+    return 0;
+}
+
+
+// Serve a request of every connection in the queue and give the connection back to the main thread, until the daemon shuts down
+void *runWorker(void *arg)
+{
+    worker *self = arg;
+    int client_fd;
+
+    self->context.cache = &encoder_cache;
+
+    while (1)
+    {
+        pthread_mutex_lock(&queue.mutex);
+        while (queue.count == 0 && !queue.shutting_down)
+        {
+            pthread_cond_wait(&queue.not_empty, &queue.mutex);
+        }
+        if (queue.count == 0)
+        {
+            pthread_mutex_unlock(&queue.mutex);
+            return NULL;
+        }
+        client_fd = queue.fds[queue.head];
+        queue.head = (queue.head + 1) % HUFFD_QUEUE_LENGTH;
+        queue.count--;
+        pthread_cond_signal(&queue.not_full);
+        pthread_mutex_unlock(&queue.mutex);
+
+        // The main thread waits for the next request of the connection (writing an int into a pipe is atomic)
+        if (!serveNextRequest(self, client_fd)
+            || write(returned_connections[1], &client_fd, sizeof(client_fd)) != sizeof(client_fd))
+        {
+            close(client_fd);
+        }
+    }
+}
+
+
+// Serve the next request of a client. Returns 1 if the connection can be used for another request and 0 if it must be closed.
+int serveNextRequest(worker *self, int client_fd)
+{
+    huffd_request request;
+    huffd_response response;
+    struct timespec start;
+    char *result = NULL;  // inline result of the request
+    size_t result_size = 0;
+    int in_fd, out_fd;  // file descriptors passed with the request
+    int is_open;
+
+    if (receiveRequest(client_fd, &request, &in_fd, &out_fd) != 1)
+    {
+        return 0;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    response.status = serveRequest(self, client_fd, &request, in_fd, out_fd, &result, &result_size);
+    response.data_size = (long)result_size;
+
+    if (request.operation == HUFFD_ENCODE || request.operation == HUFFD_DECODE)
+    {
+        recordLatency(request.operation, &start, response.status);
+    }
+
+    is_open = writeAll(client_fd, &response, sizeof(response)) == 0 && writeAll(client_fd, result, result_size) == 0;
+    free(result);
+
+    // Inline data that was not read would be taken for the next request
+    if (!request.with_fds && (response.status == FAIL_REQUEST_TOO_LARGE || response.status == FAIL_OPEN_INPUT_FILE))
+    {
+        is_open = 0;
+    }
+
+    return is_open;
+}
+
+
+// Encode or decode the input of a request into out_fd or into an inline result. Returns 0 if successful or one of the error codes in common.h.
+int serveRequest(worker *self, int client_fd, const huffd_request *request, int in_fd, int out_fd,
+                 char **result, size_t *result_size)
+{
+    FILE *fp_in_file = NULL;
+    FILE *fp_out_file = NULL;
+    long input_size = 0;
+    int status;
+
+    if (request->operation == HUFFD_STATS)
+    {
+        // The stats are always inline, file descriptors passed with the request are not used
+        if (in_fd != -1)
+        {
+            close(in_fd);
+        }
+        if (out_fd != -1)
+        {
+            close(out_fd);
+        }
+        fp_out_file = open_memstream(result, result_size);
+        if (fp_out_file == NULL)
+        {
+            return FAIL_ALLOCATE_MEMORY;
+        }
+        printLatencyStats(fp_out_file);
+        fclose(fp_out_file);
+        return 0;
+    }
+
+    // The input is read into memory, so that the encoder can read it twice even if in_fd is a pipe
+    status = readRequestInput(self, client_fd, request, in_fd, &input_size);
+    if (in_fd != -1)
+    {
+        close(in_fd);
+    }
+    if (status != 0 || (request->operation != HUFFD_ENCODE && request->operation != HUFFD_DECODE))
+    {
+        if (out_fd != -1)
+        {
+            close(out_fd);
+        }
+        return status != 0 ? status : FAIL_OPEN_INPUT_FILE;
+    }
+
+    fp_in_file = fmemopen(self->buffer, input_size, "r");
+    fp_out_file = out_fd != -1 ? fdopen(out_fd, "w") : open_memstream(result, result_size);
+    if (fp_in_file == NULL || fp_out_file == NULL)
+    {
+        if (fp_in_file)
+        {
+            fclose(fp_in_file);
+        }
+        if (fp_out_file)
+        {
+            fclose(fp_out_file);
+        }
+        else if (out_fd != -1)
+        {
+            close(out_fd);
+        }
+        return FAIL_OPEN_OUTPUT_FILE;
+    }
+
+    if (request->operation == HUFFD_ENCODE)
+    {
+        status = encodeFile(fp_in_file, fp_out_file, &self->context);
+    }
+    else
+    {
+        // A few bytes of input can decode into gigabytes, the output is limited like the input
+        status = decodeFile(fp_in_file, fp_out_file, &decoder_cache, max_request_size);
+    }
+
+    fclose(fp_in_file);
+    if (fclose(fp_out_file) == EOF && status == 0)
+    {
+        status = FAIL_WRITE_BODY;
+    }
+
+    return status;
+}
+
+
+// Read a request's input (inline data or everything from in_fd, at most max_request_size bytes) into the buffer of the worker.
+// *p_input_size is set to its size. Returns 0 if successful or one of the error codes in common.h.
+int readRequestInput(worker *self, int client_fd, const huffd_request *request, int in_fd, long *p_input_size)
+{
+    size_t size = 0;
+    size_t capacity;
+    ssize_t bytes_read;
+
+    if (!request->with_fds)
+    {
+        // The size comes from the client, it is checked before allocating the buffer
+        if (request->data_size < 0)
+        {
+            return FAIL_OPEN_INPUT_FILE;
+        }
+        if (request->data_size > max_request_size)
+        {
+            return FAIL_REQUEST_TOO_LARGE;
+        }
+        if (reserveBuffer(self, request->data_size) == -1)
+        {
+            return FAIL_ALLOCATE_MEMORY;
+        }
+        if (readAll(client_fd, self->buffer, request->data_size) == -1)
+        {
+            return FAIL_OPEN_INPUT_FILE;
+        }
+        *p_input_size = request->data_size;
+        return 0;
+    }
+
+    if (in_fd == -1)
+    {
+        return FAIL_OPEN_INPUT_FILE;
+    }
+
+    // The size is not known in advance, double the buffer whenever it gets full (up to a byte more than allowed)
+    while (1)
+    {
+        if (size == self->buffer_capacity)
+        {
+            capacity = size * 2 > COPY_BUFFER_SIZE ? size * 2 : COPY_BUFFER_SIZE;
+            if (capacity > (size_t)max_request_size + 1)
+            {
+                capacity = (size_t)max_request_size + 1;
+            }
+            if (reserveBuffer(self, capacity) == -1)
+            {
+                return FAIL_ALLOCATE_MEMORY;
+            }
+        }
+
+        // A pipe that the client keeps open without writing into it must not hold the worker forever
+        if (waitForInput(in_fd) == -1)
+        {
+            return FAIL_OPEN_INPUT_FILE;
+        }
+        bytes_read = read(in_fd, self->buffer + size, self->buffer_capacity - size);
+        if (bytes_read == -1 && errno == EINTR)
+        {
+            continue;
+        }
+        if (bytes_read == -1)
+        {
+            return FAIL_OPEN_INPUT_FILE;
+        }
+        if (bytes_read == 0)
+        {
+            *p_input_size = (long)size;
+            return 0;
+        }
+        size += bytes_read;
+        if (size > (size_t)max_request_size)
+        {
+            return FAIL_REQUEST_TOO_LARGE;
+        }
+    }
+}
+
+
+// Wait until fd can be read, at most HUFFD_IO_TIMEOUT seconds. Returns 0 if it can be read and -1 if unsuccessful.
+int waitForInput(int fd)
+{
+    struct pollfd poll_fd = {fd, POLLIN, 0};
+    int result;
+
+    do
+    {
+        result = poll(&poll_fd, 1, HUFFD_IO_TIMEOUT * 1000);
+    }
+    while (result == -1 && errno == EINTR);
+
+    return result == 1 ? 0 : -1;
+}
+
+
+// Make the buffer of the worker at least capacity bytes big. Returns 0 if successful and -1 if unsuccessful.
+// The buffer only grows, so a warm worker doesn't allocate memory for inputs that are not bigger than the previous ones.
+int reserveBuffer(worker *self, size_t capacity)
+{
+    char *new_buffer;
+
+    // fmemopen() needs a buffer even for an empty input
+    if (capacity == 0)
+    {
+        capacity = 1;
+    }
+    if (self->buffer_capacity >= capacity)
+    {
+        return 0;
+    }
+
+    new_buffer = realloc(self->buffer, capacity);
+    if (new_buffer == NULL)
+    {
+        return -1;
+    }
+    self->buffer = new_buffer;
+    self->buffer_capacity = capacity;
+
+    return 0;
+}
+
+
+// Add the latency of a served request to the histograms
+void recordLatency(char operation, const struct timespec *start, int status)
+{
+    struct timespec end;
+    long microseconds;
+    int bucket = 0;
+    int index = operation == HUFFD_ENCODE ? 0 : 1;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    microseconds = (end.tv_sec - start->tv_sec) * 1000000 + (end.tv_nsec - start->tv_nsec) / 1000;
+
+    // Bucket i holds latencies in [2^(i-1), 2^i) microseconds
+    while (microseconds > 0 && bucket < HUFFD_LATENCY_BUCKETS - 1)
+    {
+        microseconds >>= 1;
+        bucket++;
+    }
+
+    pthread_mutex_lock(&stats.mutex);
+    stats.histogram[index][bucket]++;
+    stats.requests[index]++;
+    if (status != 0)
+    {
+        stats.failures[index]++;
+    }
+    pthread_mutex_unlock(&stats.mutex);
+}
+
+
+// Print the request counts, latency histograms and codebook cache hits and misses
+void printLatencyStats(FILE *fp_out_file)
+{
+    const char *names[2] = {"encode", "decode"};
+
+    pthread_mutex_lock(&stats.mutex);
+    for (int i = 0; i < 2; i++)
+    {
+        fprintf(fp_out_file, "%s: %lu requests, %lu failed\n", names[i], stats.requests[i], stats.failures[i]);
+        for (int bucket = 0; bucket < HUFFD_LATENCY_BUCKETS; bucket++)
+        {
+            if (stats.histogram[i][bucket])
+            {
+                fprintf(fp_out_file, "  < %10lu us: %lu\n", 1UL << bucket, stats.histogram[i][bucket]);
+            }
+        }
+    }
+    pthread_mutex_unlock(&stats.mutex);
+
+    pthread_mutex_lock(&encoder_cache.mutex);
+    fprintf(fp_out_file, "encoder codebook cache: %lu hits, %lu misses\n", encoder_cache.hits, encoder_cache.misses);
+    pthread_mutex_unlock(&encoder_cache.mutex);
+    pthread_mutex_lock(&decoder_cache.mutex);
+    fprintf(fp_out_file, "decoder codebook cache: %lu hits, %lu misses\n", decoder_cache.hits, decoder_cache.misses);
+    pthread_mutex_unlock(&decoder_cache.mutex);
+}
+
+
+// Stop accepting connections on SIGINT and SIGTERM
+void handleStopSignal(int signal_number)
+{
+    (void)signal_number;
+    stop_requested = 1;
+}
+
+
+// Add the connection to the queue of the workers, waits while the queue is full
+void queueConnection(int client_fd)
+{
+    pthread_mutex_lock(&queue.mutex);
+    while (queue.count == HUFFD_QUEUE_LENGTH && !stop_requested)
+    {
+        pthread_cond_wait(&queue.not_full, &queue.mutex);
+    }
+    if (queue.count == HUFFD_QUEUE_LENGTH)
+    {
+        close(client_fd);  // stopped while waiting for room in the queue
+    }
+    else
+    {
+        queue.fds[(queue.head + queue.count) % HUFFD_QUEUE_LENGTH] = client_fd;
+        queue.count++;
+        pthread_cond_signal(&queue.not_empty);
+    }
+    pthread_mutex_unlock(&queue.mutex);
+}
+
+
+// Give up on a client that stops sending its request or reading its response after HUFFD_IO_TIMEOUT seconds
+void setConnectionTimeouts(int client_fd)
+{
+    struct timeval timeout = {HUFFD_IO_TIMEOUT, 0};
+
+    setsockopt(client_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(client_fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+}
+
+
+// Add a file descriptor to the polled ones. Returns 0 if successful and -1 if unsuccessful.
+int addToPollSet(poll_set *set, int fd)
+{
+    struct pollfd *new_fds;
+
+    if (set->count == set->capacity)
+    {
+        new_fds = realloc(set->fds, (set->capacity ? set->capacity * 2 : 16) * sizeof(struct pollfd));
+        if (new_fds == NULL)
+        {
+            return -1;
+        }
+        set->fds = new_fds;
+        set->capacity = set->capacity ? set->capacity * 2 : 16;
+    }
+
+    set->fds[set->count].fd = fd;
+    set->fds[set->count].events = POLLIN;
+    set->fds[set->count].revents = 0;
+    set->count++;
+
+    return 0;
+}
+
+
+// Stop polling the file descriptor at index (the last one takes its place)
+void removeFromPollSet(poll_set *set, int index)
+{
+    set->fds[index] = set->fds[--set->count];
+}
@@ -0,0 +1,51 @@
+/*
+ * Data structures, macros and function declarations of the protocol
+ * between the compression daemon (./huffd) and its clients (./huffc)
+*/
+
+
+#ifndef HUFFD_H
+#define HUFFD_H
+
+#include <stddef.h>
+
+#define HUFFD_SOCKET_PATH "/tmp/huffd.sock"  // Default path of the Unix domain socket the daemon listens on
+#define HUFFD_NUM_WORKERS 4  // Default number of threads serving requests
+#define HUFFD_QUEUE_LENGTH 64  // Max number of connections with a request waiting for a free worker
+#define HUFFD_MAX_REQUEST_SIZE (256L << 20)  // Default max size of the input (and of the decoded output) of a request, larger requests fail with FAIL_REQUEST_TOO_LARGE
+#define HUFFD_MAX_RECEIVED_FDS 8  // Room for file descriptors passed with a request, more are dropped by the kernel and the request is refused
+#define HUFFD_IO_TIMEOUT 10  // Seconds a worker waits for the next bytes of a request (or for room to write its response) before giving up
+#define HUFFD_LATENCY_BUCKETS 32  // Bucket i of a latency histogram counts requests that took [2^(i-1), 2^i) microseconds
+
+// Operations a client can request
+#define HUFFD_ENCODE 'e'
+#define HUFFD_DECODE 'd'
+#define HUFFD_STATS 's'
+
+
+// Sent by the client for every request. The input is either data_size bytes of inline data following the request
+// or, if with_fds is set, a file descriptor passed with the request together with the file descriptor for the output.
+typedef struct huffd_request
+{
+    char operation;  // HUFFD_ENCODE, HUFFD_DECODE or HUFFD_STATS
+    char with_fds;
+    long data_size;  // size of the inline data following the request
+} huffd_request;
+
+// Sent by the daemon for every request, followed by data_size bytes of inline output (none if the output file descriptor was passed)
+typedef struct huffd_response
+{
+    int status;  // 0 if successful or one of the error codes in common.h
+    long data_size;
+} huffd_response;
+
+
+// Send a request, passing in_fd and out_fd with it if request->with_fds is set. Returns 0 if successful and -1 if unsuccessful.
+int sendRequest(int socket_fd, const huffd_request *request, int in_fd, int out_fd);
+
+// Receive a request and the file descriptors passed with it (-1 if none). They are kept only if request->with_fds is set
+// and exactly two arrived, any other descriptors are closed. Returns 1 if a request was received,
+// 0 if the other side closed the connection and -1 if unsuccessful (including more descriptors than HUFFD_MAX_RECEIVED_FDS).
+int receiveRequest(int socket_fd, huffd_request *request, int *in_fd, int *out_fd);
+
+#endif
@@ -0,0 +1,120 @@
+/*
+ * Functions for sending and receiving the requests and responses
+ * used both in the compression daemon and its clients
+*/
+
+#define _DEFAULT_SOURCE  // CMSG_SPACE() and CMSG_LEN() are not part of C99
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include "common.h"
+#include "huffd.h"
+
+
+// Send a request, passing in_fd and out_fd with it if request->with_fds is set. Returns 0 if successful and -1 if unsuccessful.
+int sendRequest(int socket_fd, const huffd_request *request, int in_fd, int out_fd)
+{
+    struct iovec iov = {(void *)request, sizeof(*request)};
+    struct msghdr message = {0};
+    char control[CMSG_SPACE(2 * sizeof(int))];  // room for the two passed file descriptors
+    struct cmsghdr *control_message;
+    int fds[2] = {in_fd, out_fd};
+
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+
+    if (request->with_fds)
+    {
+        memset(control, 0, sizeof(control));
+        message.msg_control = control;
+        message.msg_controllen = sizeof(control);
+        control_message = CMSG_FIRSTHDR(&message);
+        control_message->cmsg_level = SOL_SOCKET;
+        control_message->cmsg_type = SCM_RIGHTS;
+        control_message->cmsg_len = CMSG_LEN(sizeof(fds));
+        memcpy(CMSG_DATA(control_message), fds, sizeof(fds));
+    }
+
+    if (sendmsg(socket_fd, &message, 0) != (ssize_t)sizeof(*request))
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+
+// Receive a request and the file descriptors passed with it (-1 if none). They are kept only if request->with_fds is set
+// and exactly two arrived, any other descriptors are closed. Returns 1 if a request was received,
+// 0 if the other side closed the connection and -1 if unsuccessful (including more descriptors than HUFFD_MAX_RECEIVED_FDS).
+int receiveRequest(int socket_fd, huffd_request *request, int *in_fd, int *out_fd)
+{
+    struct iovec iov = {request, sizeof(*request)};
+    struct msghdr message = {0};
+    char control[CMSG_SPACE(HUFFD_MAX_RECEIVED_FDS * sizeof(int))];
+    struct cmsghdr *control_message;
+    int fds[HUFFD_MAX_RECEIVED_FDS];
+    int num_fds = 0;
+    size_t num_message_fds;
+    int result = 1;
+    ssize_t bytes_read;
+
+    *in_fd = -1;
+    *out_fd = -1;
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+
+    do
+    {
+        bytes_read = recvmsg(socket_fd, &message, 0);
+    }
+    while (bytes_read == -1 && errno == EINTR);
+
+    if (bytes_read <= 0)
+    {
+        return bytes_read == 0 ? 0 : -1;
+    }
+
+    // Every descriptor the client passed is already open in this process, whatever the request says
+    for (control_message = CMSG_FIRSTHDR(&message); control_message; control_message = CMSG_NXTHDR(&message, control_message))
+    {
+        if (control_message->cmsg_level != SOL_SOCKET || control_message->cmsg_type != SCM_RIGHTS)
+        {
+            continue;
+        }
+        num_message_fds = (control_message->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        for (size_t i = 0; i < num_message_fds && num_fds < HUFFD_MAX_RECEIVED_FDS; i++)
+        {
+            memcpy(&fds[num_fds++], CMSG_DATA(control_message) + i * sizeof(int), sizeof(int));
+        }
+    }
+
+    // The kernel drops the descriptors that did not fit, the request can't be served as it was sent
+    if (message.msg_flags & MSG_CTRUNC)
+    {
+        result = -1;
+    }
+    // A stream socket may return the request in pieces
+    else if (bytes_read < (ssize_t)sizeof(*request)
+             && readAll(socket_fd, (char *)request + bytes_read, sizeof(*request) - bytes_read) == -1)
+    {
+        result = -1;
+    }
+    else if (request->with_fds && num_fds == 2)
+    {
+        *in_fd = fds[0];
+        *out_fd = fds[1];
+        return 1;
+    }
+
+    for (int i = 0; i < num_fds; i++)
+    {
+        close(fds[i]);
+    }
+
+    return result;
+}
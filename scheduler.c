@@ -0,0 +1,252 @@
+/*
+ * Work-stealing thread pool
+ * used for encoding and decoding many files at once
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "scheduler.h"
+
+
+// Arguments of a worker thread
+typedef struct worker_arg
+{
+    scheduler *pool;
+    int worker_index;
+} worker_arg;
+
+
+// Initialize a pool of num_workers workers. Returns 0 if successful and -1 if unsuccessful.
+int initScheduler(scheduler *pool, int num_workers)
+{
+    memset(pool, 0, sizeof(*pool));
+    pool->num_workers = num_workers;
+    pool->deques = calloc(num_workers, sizeof(task_deque));
+    pool->threads = calloc(num_workers, sizeof(pthread_t));
+    if (pool->deques == NULL || pool->threads == NULL)
+    {
+        printf("Failed to allocate memory for the workers!\n");
+        freeScheduler(pool);
+        return -1;
+    }
+
+    for (int i = 0; i < num_workers; i++)
+    {
+        pthread_mutex_init(&pool->deques[i].mutex, NULL);
+    }
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->state_changed, NULL);
+
+    return 0;
+}
+
+
+// Free the memory used by the pool
+void freeScheduler(scheduler *pool)
+{
+    if (pool->deques)
+    {
+        for (int i = 0; i < pool->num_workers; i++)
+        {
+            free(pool->deques[i].tasks);
+            pthread_mutex_destroy(&pool->deques[i].mutex);
+        }
+    }
+    free(pool->deques);
+    free(pool->threads);
+    pool->deques = NULL;
+    pool->threads = NULL;
+}
+
+
+// Add a task to the deque of a worker (-1 to spread tasks submitted from outside the pool over the workers).
+// Returns 0 if successful and -1 if unsuccessful.
+int submitTask(scheduler *pool, int worker_index, task_function function, void *arg)
+{
+    task_deque *deque;
+    task *new_tasks;
+
+    if (worker_index == -1)
+    {
+        pthread_mutex_lock(&pool->mutex);
+        worker_index = pool->next_worker;
+        pool->next_worker = (pool->next_worker + 1) % pool->num_workers;
+        pthread_mutex_unlock(&pool->mutex);
+    }
+    deque = &pool->deques[worker_index];
+
+    // Count the task before any worker can take it, otherwise it could finish first and the others would see no pending work and exit
+    pthread_mutex_lock(&pool->mutex);
+    pool->pending_tasks++;
+    pool->queued_tasks++;
+    pthread_mutex_unlock(&pool->mutex);
+
+    pthread_mutex_lock(&deque->mutex);
+    if (deque->count == deque->capacity)
+    {
+        // Double the circular buffer, moving the tasks so that the oldest one is first
+        new_tasks = malloc(sizeof(task) * (deque->capacity ? deque->capacity * 2 : SCHEDULER_INITIAL_DEQUE_CAPACITY));
+        if (new_tasks == NULL)
+        {
+            pthread_mutex_unlock(&deque->mutex);
+            printf("Failed to allocate memory for a task!\n");
+
+            pthread_mutex_lock(&pool->mutex);
+            pool->queued_tasks--;
+            if (--pool->pending_tasks == 0)
+            {
+                pthread_cond_broadcast(&pool->state_changed);
+            }
+            pthread_mutex_unlock(&pool->mutex);
+            return -1;
+        }
+        for (int i = 0; i < deque->count; i++)
+        {
+            new_tasks[i] = deque->tasks[(deque->top + i) % deque->capacity];
+        }
+        free(deque->tasks);
+        deque->tasks = new_tasks;
+        deque->capacity = deque->capacity ? deque->capacity * 2 : SCHEDULER_INITIAL_DEQUE_CAPACITY;
+        deque->top = 0;
+    }
+    deque->tasks[(deque->top + deque->count) % deque->capacity] = (task){function, arg};
+    deque->count++;
+    pthread_mutex_unlock(&deque->mutex);
+
+    // Wake up an idle worker
+    pthread_mutex_lock(&pool->mutex);
+    pthread_cond_signal(&pool->state_changed);
+    pthread_mutex_unlock(&pool->mutex);
+
+    return 0;
+}
+
+
+// Run the workers until all tasks, including the ones submitted by other tasks, have finished. Returns 0 if successful and -1 if unsuccessful.
+int runScheduler(scheduler *pool)
+{
+    worker_arg *args = malloc(sizeof(worker_arg) * pool->num_workers);
+    int started = 0;
+    int result = 0;
+
+    if (args == NULL)
+    {
+        printf("Failed to allocate memory for the workers!\n");
+        return -1;
+    }
+
+    for (; started < pool->num_workers; started++)
+    {
+        args[started] = (worker_arg){pool, started};
+        if (pthread_create(&pool->threads[started], NULL, runSchedulerWorker, &args[started]) != 0)
+        {
+            // The started workers steal the tasks of the missing ones
+            printf("Failed to start a worker!\n");
+            result = started == 0 ? -1 : 0;
+            break;
+        }
+    }
+
+    for (int i = 0; i < started; i++)
+    {
+        pthread_join(pool->threads[i], NULL);
+    }
+    free(args);
+
+    return result;
+}
+
+
+// The loop of a worker thread: run its own tasks, steal from the others when it has none, exit when all tasks have finished
+void *runSchedulerWorker(void *arg)
+{
+    scheduler *pool = ((worker_arg *)arg)->pool;
+    int worker_index = ((worker_arg *)arg)->worker_index;
+    task current_task;
+    int found;
+
+    while (1)
+    {
+        // Newest own task first (its data is most likely still in the cache), otherwise the oldest task of another worker
+        found = popTask(&pool->deques[worker_index], &current_task);
+        for (int i = 1; !found && i < pool->num_workers; i++)
+        {
+            found = stealTask(&pool->deques[(worker_index + i) % pool->num_workers], &current_task);
+            if (found)
+            {
+                pthread_mutex_lock(&pool->mutex);
+                pool->steals++;
+                pthread_mutex_unlock(&pool->mutex);
+            }
+        }
+
+        if (found)
+        {
+            pthread_mutex_lock(&pool->mutex);
+            pool->queued_tasks--;
+            pthread_mutex_unlock(&pool->mutex);
+
+            current_task.function(pool, worker_index, current_task.arg);
+
+            pthread_mutex_lock(&pool->mutex);
+            if (--pool->pending_tasks == 0)
+            {
+                pthread_cond_broadcast(&pool->state_changed);
+            }
+            pthread_mutex_unlock(&pool->mutex);
+            continue;
+        }
+
+        // Nothing to steal: wait until a running task submits a new one or the last one finishes
+        pthread_mutex_lock(&pool->mutex);
+        while (pool->queued_tasks == 0 && pool->pending_tasks > 0)
+        {
+            pthread_cond_wait(&pool->state_changed, &pool->mutex);
+        }
+        if (pool->pending_tasks == 0)
+        {
+            pthread_mutex_unlock(&pool->mutex);
+            return NULL;
+        }
+        pthread_mutex_unlock(&pool->mutex);
+    }
+}
+
+
+// Take the newest task of a deque. Returns 1 if a task was taken and 0 if the deque is empty.
+int popTask(task_deque *deque, task *p_task)
+{
+    int found = 0;
+
+    pthread_mutex_lock(&deque->mutex);
+    if (deque->count > 0)
+    {
+        deque->count--;
+        *p_task = deque->tasks[(deque->top + deque->count) % deque->capacity];
+        found = 1;
+    }
+    pthread_mutex_unlock(&deque->mutex);
+
+    return found;
+}
+
+
+// Take the oldest task of a deque. Returns 1 if a task was taken and 0 if the deque is empty.
+int stealTask(task_deque *deque, task *p_task)
+{
+    int found = 0;
+
+    pthread_mutex_lock(&deque->mutex);
+    if (deque->count > 0)
+    {
+        *p_task = deque->tasks[deque->top];
+        deque->top = (deque->top + 1) % deque->capacity;
+        deque->count--;
+        found = 1;
+    }
+    pthread_mutex_unlock(&deque->mutex);
+
+    return found;
+}
@@ -0,0 +1,73 @@
+/*
+ * Data structures and function declarations of the work-stealing thread pool
+ * used for encoding and decoding many files at once
+*/
+
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <pthread.h>
+
+#define SCHEDULER_INITIAL_DEQUE_CAPACITY 64  // Number of tasks a worker's deque can hold before it grows
+
+
+struct scheduler;
+
+// A task gets the pool and the index of the worker running it, so that it can submit more tasks to the same worker
+typedef void (*task_function)(struct scheduler *pool, int worker_index, void *arg);
+
+typedef struct task
+{
+    task_function function;
+    void *arg;
+} task;
+
+// Tasks of a worker. The worker takes the newest task from the bottom, idle workers steal the oldest one from the top.
+typedef struct task_deque
+{
+    task *tasks;  // circular buffer
+    int capacity;
+    int top;  // index of the oldest task
+    int count;
+    pthread_mutex_t mutex;
+} task_deque;
+
+// A pool of workers, each with its own deque of tasks
+typedef struct scheduler
+{
+    int num_workers;
+    task_deque *deques;
+    pthread_t *threads;
+    long pending_tasks;  // submitted tasks that have not finished yet
+    long queued_tasks;  // submitted tasks that have not started yet
+    unsigned long steals;  // number of tasks run by another worker than the one they were submitted to
+    int next_worker;  // worker that gets the next task submitted from outside the pool
+    pthread_mutex_t mutex;
+    pthread_cond_t state_changed;  // signalled when a task is submitted or the last one finishes
+} scheduler;
+
+
+// Initialize a pool of num_workers workers. Returns 0 if successful and -1 if unsuccessful.
+int initScheduler(scheduler *pool, int num_workers);
+
+// Free the memory used by the pool
+void freeScheduler(scheduler *pool);
+
+// Add a task to the deque of a worker (-1 to spread tasks submitted from outside the pool over the workers).
+// Returns 0 if successful and -1 if unsuccessful.
+int submitTask(scheduler *pool, int worker_index, task_function function, void *arg);
+
+// Run the workers until all tasks, including the ones submitted by other tasks, have finished. Returns 0 if successful and -1 if unsuccessful.
+int runScheduler(scheduler *pool);
+
+// The loop of a worker thread: run its own tasks, steal from the others when it has none, exit when all tasks have finished
+void *runSchedulerWorker(void *arg);
+
+// Take the newest task of a deque. Returns 1 if a task was taken and 0 if the deque is empty.
+int popTask(task_deque *deque, task *p_task);
+
+// Take the oldest task of a deque. Returns 1 if a task was taken and 0 if the deque is empty.
+int stealTask(task_deque *deque, task *p_task);
+
+#endif
@@ -0,0 +1,749 @@
+/*
+ * Encode and decode incrementally: the input is fed in chunks as it arrives
+ * and every call hands out the output it completes, without blocking
+*/
+
+#define _DEFAULT_SOURCE  // fmemopen() and open_memstream() are not part of C99
+
+#include <unistd.h>
+#include <errno.h>
+#include "stream.h"
+
+
+// Prepare a stream for encoding, pairs of characters are also tried if use_pairs is set.
+// Returns 0 if successful or FAIL_ALLOCATE_MEMORY.
+int initEncoderStream(encoder_stream *stream, int use_pairs)
+{
+    memset(stream, 0, sizeof(*stream));
+    stream->context = calloc(1, sizeof(encoder_context));
+    stream->block = malloc(MAX_BLOCK_SIZE);
+    if (stream->context == NULL || stream->block == NULL)
+    {
+        freeEncoderStream(stream);
+        return FAIL_ALLOCATE_MEMORY;
+    }
+    stream->context->use_pairs = use_pairs;
+
+    return 0;
+}
+
+
+// Add input_size characters to the stream. *p_output is set to the blocks completed by them (often none), valid until the next call.
+// Returns 0 if successful or one of the error codes in common.h.
+int feedEncoderStream(encoder_stream *stream, const unsigned char *input, size_t input_size, const char **p_output, size_t *p_output_size)
+{
+    size_t chunk_size;
+    int result = 0;
+
+    // Nothing is handed out if the call fails before the output is opened
+    *p_output = NULL;
+    *p_output_size = 0;
+    if (stream->finished)
+    {
+        return FAIL_WRITE_BODY;
+    }
+    if (openStreamOutput(&stream->fp_output, &stream->output, &stream->output_size) == -1)
+    {
+        return FAIL_ALLOCATE_MEMORY;
+    }
+
+    // Every full block is encoded right away, the rest waits for more input
+    while (result == 0 && input_size > 0)
+    {
+        chunk_size = MAX_BLOCK_SIZE - stream->block_size;
+        if (chunk_size > input_size)
+        {
+            chunk_size = input_size;
+        }
+        memcpy(stream->block + stream->block_size, input, chunk_size);
+        stream->block_size += chunk_size;
+        input += chunk_size;
+        input_size -= chunk_size;
+
+        if (stream->block_size == MAX_BLOCK_SIZE)
+        {
+            result = encodeStreamBlock(stream);
+        }
+    }
+
+    if (closeStreamOutput(&stream->fp_output, &stream->output, &stream->output_size, p_output, p_output_size) == -1 && result == 0)
+    {
+        result = FAIL_ALLOCATE_MEMORY;
+    }
+
+    return result;
+}
+
+
+// Encode the characters fed so far into a block even if it is not full, so that the receiver can decode all of them.
+// *p_output is set to the block, valid until the next call. Returns 0 if successful or one of the error codes in common.h.
+int flushEncoderStream(encoder_stream *stream, const char **p_output, size_t *p_output_size)
+{
+    int result = 0;
+
+    *p_output = NULL;
+    *p_output_size = 0;
+    if (openStreamOutput(&stream->fp_output, &stream->output, &stream->output_size) == -1)
+    {
+        return FAIL_ALLOCATE_MEMORY;
+    }
+
+    // An empty block is written only when it is the only one, so that the output is a valid compressed file
+    if (stream->block_size > 0 || (stream->finished && stream->num_blocks == 0))
+    {
+        result = encodeStreamBlock(stream);
+    }
+
+    if (closeStreamOutput(&stream->fp_output, &stream->output, &stream->output_size, p_output, p_output_size) == -1 && result == 0)
+    {
+        result = FAIL_ALLOCATE_MEMORY;
+    }
+
+    return result;
+}
+
+
+// Flush the stream and end it. A stream that nothing was fed to ends with an empty block, so that the output is a valid compressed file.
+// *p_output is set to the last blocks, valid until the next call. Returns 0 if successful or one of the error codes in common.h.
+int finishEncoderStream(encoder_stream *stream, const char **p_output, size_t *p_output_size)
+{
+    *p_output = NULL;
+    *p_output_size = 0;
+    if (stream->finished)
+    {
+        return FAIL_WRITE_BODY;
+    }
+
+    stream->finished = 1;
+    return flushEncoderStream(stream, p_output, p_output_size);
+}
+
+
+// Free the memory used by the stream and its last output
+void freeEncoderStream(encoder_stream *stream)
+{
+    free(stream->context);
+    free(stream->block);
+    free(stream->output);
+    memset(stream, 0, sizeof(*stream));
+}
+
+
+// Encode the collected characters as a single block into the output of the current call. Returns 0 if successful or one of the error codes in common.h.
+int encodeStreamBlock(encoder_stream *stream)
+{
+    FILE *fp_block;  // Reads the collected characters like a file
+    int result;
+
+    fp_block = fmemopen(stream->block, stream->block_size, "r");
+    if (fp_block == NULL)
+    {
+        return FAIL_ALLOCATE_MEMORY;
+    }
+
+    result = encodeFile(fp_block, stream->fp_output, stream->context);
+    fclose(fp_block);
+
+    stream->block_size = 0;
+    stream->num_blocks++;
+
+    return result;
+}
+
+
+// Prepare a stream for decoding
+void initDecoderStream(decoder_stream *stream)
+{
+    memset(stream, 0, sizeof(*stream));
+    stream->state = STREAM_STATE_HEADER;
+}
+
+
+// Decode input_size bytes of a compressed file. *p_output is set to every character they complete, valid until the next call.
+// Returns 0 if successful or one of the error codes in common.h.
+int feedDecoderStream(decoder_stream *stream, const unsigned char *input, size_t input_size, const char **p_output, size_t *p_output_size)
+{
+    long header_size;  // bytes of the header needed so far
+    size_t chunk_size;
+    char bit;
+    int result = 0;
+
+    // Nothing is handed out if the call fails before the output is opened
+    *p_output = NULL;
+    *p_output_size = 0;
+    if (stream->state == STREAM_STATE_FAILED)
+    {
+        return FAIL_READ_BODY;
+    }
+    if (openStreamOutput(&stream->fp_output, &stream->output, &stream->output_size) == -1)
+    {
+        return FAIL_ALLOCATE_MEMORY;
+    }
+
+    // Go on from wherever the previous chunk stopped, until this chunk runs out
+    while (result == 0)
+    {
+        if (stream->state == STREAM_STATE_HEADER)
+        {
+            header_size = streamHeaderSize(stream);
+            if (header_size == -1)
+            {
+                result = FAIL_READ_HEADER;
+            }
+            else if ((size_t)header_size > stream->header_size)
+            {
+                if (input_size == 0)
+                {
+                    break;
+                }
+                chunk_size = (size_t)header_size - stream->header_size;
+                if (chunk_size > input_size)
+                {
+                    chunk_size = input_size;
+                }
+                memcpy(stream->header + stream->header_size, input, chunk_size);
+                stream->header_size += chunk_size;
+                stream->stream_offset += chunk_size;
+                input += chunk_size;
+                input_size -= chunk_size;
+            }
+            else
+            {
+                result = startStreamBlock(stream);
+            }
+        }
+        else if (stream->state == STREAM_STATE_RAW)
+        {
+            if (stream->characters_written == stream->decoded_file_size)
+            {
+                endStreamBlock(stream);
+                continue;
+            }
+            if (input_size == 0)
+            {
+                break;
+            }
+            chunk_size = (size_t)(stream->decoded_file_size - stream->characters_written);
+            if (chunk_size > input_size)
+            {
+                chunk_size = input_size;
+            }
+            if (fwrite(input, 1, chunk_size, stream->fp_output) != chunk_size)
+            {
+                result = FAIL_READ_BODY;
+            }
+            stream->characters_written += chunk_size;
+            stream->stream_offset += chunk_size;
+            input += chunk_size;
+            input_size -= chunk_size;
+        }
+        else
+        {
+            // The tree and the content are read bit by bit from the same bytes, the bits left after the content are padding
+            if (stream->remaining_bits == 0)
+            {
+                if (input_size == 0)
+                {
+                    break;
+                }
+                stream->i_byte = *input++;
+                input_size--;
+                stream->stream_offset++;
+                stream->remaining_bits = CHAR_BIT;
+            }
+            while (result == 0 && stream->remaining_bits > 0
+                   && (stream->state == STREAM_STATE_TREE || stream->state == STREAM_STATE_BODY))
+            {
+                // Read the bits starting from MSB to LSB
+                stream->remaining_bits--;
+                bit = (stream->i_byte >> stream->remaining_bits) & 1;
+                result = readStreamBit(stream, bit);
+            }
+        }
+    }
+
+    if (result != 0)
+    {
+        stream->state = STREAM_STATE_FAILED;
+    }
+    if (closeStreamOutput(&stream->fp_output, &stream->output, &stream->output_size, p_output, p_output_size) == -1 && result == 0)
+    {
+        result = FAIL_ALLOCATE_MEMORY;
+    }
+
+    return result;
+}
+
+
+// Every character that can be decoded is already handed out by feedDecoderStream(), so the output is always empty.
+// Kept so that the decoder has the same shape as the encoder. Returns 0 if successful or FAIL_READ_BODY if the stream failed before.
+int flushDecoderStream(decoder_stream *stream, const char **p_output, size_t *p_output_size)
+{
+    *p_output = NULL;
+    *p_output_size = 0;
+
+    return stream->state == STREAM_STATE_FAILED ? FAIL_READ_BODY : 0;
+}
+
+
+// End the stream. *p_output is set to an empty output. Returns 0 if the input ended after a whole block or FAIL_READ_HEADER if it was cut off.
+int finishDecoderStream(decoder_stream *stream, const char **p_output, size_t *p_output_size)
+{
+    int result = flushDecoderStream(stream, p_output, p_output_size);
+
+    // A compressed file has at least one block and the last one must be complete
+    if (result == 0 && (stream->state != STREAM_STATE_HEADER || stream->header_size > 0 || stream->stream_offset == 0))
+    {
+        result = FAIL_READ_HEADER;
+    }
+
+    return result;
+}
+
+
+// Free the trees after the latest STREAM_MAX_TREES ones, except the tree of the first block of the stream
+void evictStreamTrees(decoder_stream *stream)
+{
+    stream_tree **p_tree = &stream->trees;
+    stream_tree *tree;
+    int num_trees = 0;
+
+    while (*p_tree)
+    {
+        tree = *p_tree;
+        if (++num_trees > STREAM_MAX_TREES && tree->offset != 0)
+        {
+            *p_tree = tree->next;
+            freeBinaryTree(tree->root);
+            free(tree);
+        }
+        else
+        {
+            p_tree = &tree->next;
+        }
+    }
+}
+
+
+// Free the memory used by the stream, its trees and its last output
+void freeDecoderStream(decoder_stream *stream)
+{
+    stream_tree *tree;
+
+    freePriorityQueue(&stream->stack);
+    if (stream->owns_root)
+    {
+        freeBinaryTree(stream->root);
+    }
+    while (stream->trees)
+    {
+        tree = stream->trees;
+        stream->trees = tree->next;
+        freeBinaryTree(tree->root);
+        free(tree);
+    }
+    free(stream->output);
+    memset(stream, 0, sizeof(*stream));
+}
+
+
+// Returns the number of header bytes needed to know the whole header of the current block (more may be needed once they are read)
+// or -1 if the header is not valid.
+long streamHeaderSize(decoder_stream *stream)
+{
+    size_t fixed_size = sizeof(long) + sizeof(unsigned char);  // the size of the content and the block type
+    unsigned short int num_pairs;
+
+    if (stream->header_size < fixed_size)
+    {
+        return fixed_size;
+    }
+
+    switch (stream->header[sizeof(long)])
+    {
+        case BLOCK_TYPE_HUFFMAN:
+            return fixed_size + sizeof(unsigned short int);
+        case BLOCK_TYPE_RAW:
+            return fixed_size;
+        case BLOCK_TYPE_RUN:
+            return fixed_size + sizeof(unsigned char);
+        case BLOCK_TYPE_REUSE:
+        case BLOCK_TYPE_INDEX:
+            return fixed_size + sizeof(long);
+        case BLOCK_TYPE_PAIRS:
+            // The number of pairs tells where the size of the tree is
+            if (stream->header_size < fixed_size + sizeof(num_pairs))
+            {
+                return fixed_size + sizeof(num_pairs);
+            }
+            memcpy(&num_pairs, stream->header + fixed_size, sizeof(num_pairs));
+            if (num_pairs > MAX_PAIR_SYMBOLS)
+            {
+                return -1;
+            }
+            return fixed_size + sizeof(num_pairs) + num_pairs * 2 + sizeof(unsigned short int);
+        default:
+            return -1;
+    }
+}
+
+
+// Read the complete header of the current block and write its content if there is nothing else to read (BLOCK_TYPE_RUN).
+// Returns 0 if successful or one of the error codes in common.h.
+int startStreamBlock(decoder_stream *stream)
+{
+    unsigned char *field = stream->header;  // The next field of the header
+    unsigned short int tree_size;  // number of nodes in the Huffman tree
+    long codebook_distance;  // distance back to the block with the Huffman tree (BLOCK_TYPE_REUSE and BLOCK_TYPE_INDEX)
+    stream_tree *tree;
+
+    // The fields are read like decodeBlock() reads them from a file
+    memcpy(&stream->decoded_file_size, field, sizeof(long));
+    field += sizeof(long);
+    stream->block_type = *field++;
+    stream->block_offset = stream->stream_offset - stream->header_size;
+    stream->characters_written = 0;
+    stream->remaining_bits = 0;
+    if (stream->decoded_file_size < 0)
+    {
+        return FAIL_READ_HEADER;
+    }
+
+    if (stream->block_type == BLOCK_TYPE_PAIRS)
+    {
+        memcpy(&stream->num_pairs, field, sizeof(stream->num_pairs));
+        field += sizeof(stream->num_pairs);
+        memcpy(stream->pairs, field, stream->num_pairs * 2);
+        field += stream->num_pairs * 2;
+    }
+
+    if (stream->block_type == BLOCK_TYPE_HUFFMAN || stream->block_type == BLOCK_TYPE_PAIRS)
+    {
+        // The tree is reconstructed as its bits arrive
+        memcpy(&tree_size, field, sizeof(tree_size));
+        if (tree_size == 0)
+        {
+            return FAIL_CREATE_HUFFMAN_TREE;
+        }
+        stream->symbol_bits = stream->block_type == BLOCK_TYPE_PAIRS ? PAIR_SYMBOL_BITS : CHAR_BIT;
+        stream->remaining_tree_nodes = tree_size;
+        stream->remaining_symbol_bits = 0;
+        stream->state = STREAM_STATE_TREE;
+    }
+    else if (stream->block_type == BLOCK_TYPE_RUN)
+    {
+        if (writeRepeatedCharacter((char)*field, stream->decoded_file_size, stream->fp_output) == EOF)
+        {
+            return FAIL_READ_BODY;
+        }
+        endStreamBlock(stream);
+    }
+    else if (stream->block_type == BLOCK_TYPE_REUSE)
+    {
+        // The block refers to a tree that was reconstructed earlier in the stream
+        memcpy(&codebook_distance, field, sizeof(codebook_distance));
+        for (tree = stream->trees; tree != NULL && tree->offset != stream->block_offset - codebook_distance; tree = tree->next)
+        {
+        }
+        if (tree == NULL)
+        {
+            return FAIL_CREATE_HUFFMAN_TREE;
+        }
+        stream->root = tree->root;
+        stream->owns_root = 0;
+        stream->trav = stream->root;
+        stream->state = stream->decoded_file_size > 0 ? STREAM_STATE_BODY : STREAM_STATE_HEADER;
+        if (stream->state == STREAM_STATE_HEADER)
+        {
+            endStreamBlock(stream);
+        }
+    }
+    else if (stream->block_type == BLOCK_TYPE_INDEX)
+    {
+        // An index only helps the next append to find the latest tree, there is nothing to decode
+        endStreamBlock(stream);
+    }
+    else
+    {
+        stream->state = STREAM_STATE_RAW;
+    }
+
+    return 0;
+}
+
+
+// Read a bit of the serialized tree or of the encoded content of the current block. Returns 0 if successful or one of the error codes in common.h.
+int readStreamBit(decoder_stream *stream, char bit)
+{
+    node *node1, *node2;
+    stream_tree *tree;
+    int pair;  // index of the pair of a symbol from NUM_ASCII on
+
+    if (stream->state == STREAM_STATE_TREE)
+    {
+        // Leaves are denoted as 1 followed by symbol_bits of their symbol, parent nodes as 0 (see ReconstructHuffmanTree())
+        if (stream->remaining_symbol_bits > 0)
+        {
+            stream->symbol = (stream->symbol << 1) | bit;
+            if (--stream->remaining_symbol_bits > 0)
+            {
+                return 0;
+            }
+            if (pushToPriorityQueue(&stream->stack, stream->symbol, 1, NULL, NULL) == -1)
+            {
+                return FAIL_CREATE_HUFFMAN_TREE;
+            }
+        }
+        else if (bit == 1)
+        {
+            stream->remaining_symbol_bits = stream->symbol_bits;
+            stream->symbol = 0;
+            return 0;
+        }
+        else
+        {
+            node1 = popPriorityQueue(&stream->stack);
+            node2 = popPriorityQueue(&stream->stack);
+            if (node1 == NULL || node2 == NULL || pushToPriorityQueue(&stream->stack, '\0', 1, node2, node1) == -1)
+            {
+                freeBinaryTree(node1);
+                freeBinaryTree(node2);
+                return FAIL_CREATE_HUFFMAN_TREE;
+            }
+        }
+
+        if (--stream->remaining_tree_nodes > 0)
+        {
+            return 0;
+        }
+
+        // The last remaining node is the root, a root without children has no codes to decode
+        stream->root = popPriorityQueue(&stream->stack);
+        stream->owns_root = 1;
+        if (stream->stack != NULL || stream->root->left == NULL)
+        {
+            return FAIL_CREATE_HUFFMAN_TREE;
+        }
+
+        // Trees of characters may be reused by later blocks
+        if (stream->block_type == BLOCK_TYPE_HUFFMAN)
+        {
+            tree = malloc(sizeof(stream_tree));
+            if (tree == NULL)
+            {
+                return FAIL_ALLOCATE_MEMORY;
+            }
+            tree->offset = stream->block_offset;
+            tree->root = stream->root;
+            tree->next = stream->trees;
+            stream->trees = tree;
+            stream->owns_root = 0;
+            evictStreamTrees(stream);
+        }
+
+        stream->trav = stream->root;
+        stream->state = STREAM_STATE_BODY;
+        if (stream->decoded_file_size == 0)
+        {
+            endStreamBlock(stream);
+        }
+        return 0;
+    }
+
+    // if the code is '0', go to the left subtree, else to the right subtree.
+    stream->trav = bit == 0 ? stream->trav->left : stream->trav->right;
+    if (stream->trav->left != NULL || stream->trav->right != NULL)
+    {
+        return 0;
+    }
+
+    // A leaf was reached, write its characters and go back to the root
+    if (stream->trav->character < NUM_ASCII)
+    {
+        if (fputc(stream->trav->character, stream->fp_output) == EOF)
+        {
+            return FAIL_READ_BODY;
+        }
+        stream->characters_written++;
+    }
+    else
+    {
+        // A pair yields two characters, it must be one of the pairs in the header and fit into the decoded content
+        pair = stream->trav->character - NUM_ASCII;
+        if (stream->block_type != BLOCK_TYPE_PAIRS || pair >= stream->num_pairs
+            || stream->characters_written + 2 > stream->decoded_file_size
+            || fputc(stream->pairs[pair][0], stream->fp_output) == EOF
+            || fputc(stream->pairs[pair][1], stream->fp_output) == EOF)
+        {
+            return FAIL_READ_BODY;
+        }
+        stream->characters_written += 2;
+    }
+    stream->trav = stream->root;
+
+    if (stream->characters_written == stream->decoded_file_size)
+    {
+        endStreamBlock(stream);
+    }
+
+    return 0;
+}
+
+
+// Free the tree of the current block unless BLOCK_TYPE_REUSE blocks may refer to it and wait for the header of the next block
+void endStreamBlock(decoder_stream *stream)
+{
+    if (stream->owns_root)
+    {
+        freeBinaryTree(stream->root);
+    }
+    stream->root = NULL;
+    stream->trav = NULL;
+    stream->owns_root = 0;
+
+    // The rest of the current byte is padding
+    stream->remaining_bits = 0;
+    stream->header_size = 0;
+    stream->state = STREAM_STATE_HEADER;
+}
+
+
+// Open the output of the current call and free the output of the previous one. Returns 0 if successful and -1 if unsuccessful.
+int openStreamOutput(FILE **p_fp_output, char **p_output, size_t *p_output_size)
+{
+    free(*p_output);
+    *p_output = NULL;
+    *p_output_size = 0;
+
+    *p_fp_output = open_memstream(p_output, p_output_size);
+
+    return *p_fp_output == NULL ? -1 : 0;
+}
+
+
+// Close the output of the current call and hand it out. Returns 0 if successful and -1 if unsuccessful.
+int closeStreamOutput(FILE **p_fp_output, char **p_output, size_t *p_output_size, const char **p_result, size_t *p_result_size)
+{
+    int result = fclose(*p_fp_output) == EOF ? -1 : 0;
+
+    *p_fp_output = NULL;
+    *p_result = *p_output;
+    *p_result_size = *p_output_size;
+
+    return result;
+}
+
+
+// Encode everything read from in_fd into out_fd, feeding every chunk as soon as it arrives (e.g. from a pipe or a socket).
+// Errors are reported on stderr, out_fd may be stdout. Returns 0 if successful or one of the error codes in common.h.
+int streamEncodeFile(int in_fd, int out_fd, int use_pairs)
+{
+    static unsigned char chunk[STREAM_CHUNK_SIZE];
+    encoder_stream stream;
+    const char *output;
+    size_t output_size;
+    ssize_t chunk_size;
+    int result;
+
+    result = initEncoderStream(&stream, use_pairs);
+    if (result != 0)
+    {
+        fprintf(stderr, "Failed to encode the input: %s!\n", describeError(result));
+    }
+
+    // read() returns whatever has arrived instead of waiting for a whole chunk
+    while (result == 0 && (chunk_size = read(in_fd, chunk, sizeof(chunk))) != 0)
+    {
+        if (chunk_size == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            fprintf(stderr, "Failed to read the input file!\n");
+            result = FAIL_OPEN_INPUT_FILE;
+            break;
+        }
+
+        result = feedEncoderStream(&stream, chunk, (size_t)chunk_size, &output, &output_size);
+        if (result != 0)
+        {
+            fprintf(stderr, "Failed to encode the input: %s!\n", describeError(result));
+        }
+        else if (writeAll(out_fd, output, output_size) == -1)
+        {
+            fprintf(stderr, "Failed to write the compressed file!\n");
+            result = FAIL_WRITE_BODY;
+        }
+    }
+
+    if (result == 0)
+    {
+        result = finishEncoderStream(&stream, &output, &output_size);
+        if (result != 0)
+        {
+            fprintf(stderr, "Failed to encode the input: %s!\n", describeError(result));
+        }
+        else if (writeAll(out_fd, output, output_size) == -1)
+        {
+            fprintf(stderr, "Failed to write the compressed file!\n");
+            result = FAIL_WRITE_BODY;
+        }
+    }
+
+    freeEncoderStream(&stream);
+    return result;
+}
+
+
+// Decode everything read from in_fd into out_fd, writing the characters of every chunk as soon as it arrives.
+// Errors are reported on stderr, out_fd may be stdout. Returns 0 if successful or one of the error codes in common.h.
+int streamDecodeFile(int in_fd, int out_fd)
+{
+    static unsigned char chunk[STREAM_CHUNK_SIZE];
+    decoder_stream stream;
+    const char *output;
+    size_t output_size;
+    ssize_t chunk_size;
+    int result = 0;
+
+    initDecoderStream(&stream);
+
+    while (result == 0 && (chunk_size = read(in_fd, chunk, sizeof(chunk))) != 0)
+    {
+        if (chunk_size == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            fprintf(stderr, "Failed to read the input file!\n");
+            result = FAIL_OPEN_INPUT_FILE;
+            break;
+        }
+
+        // The characters decoded before an error are still written
+        result = feedDecoderStream(&stream, chunk, (size_t)chunk_size, &output, &output_size);
+        if (writeAll(out_fd, output, output_size) == -1 && result == 0)
+        {
+            fprintf(stderr, "Failed to write the decoded file!\n");
+            result = FAIL_WRITE_BODY;
+        }
+        else if (result != 0)
+        {
+            fprintf(stderr, "Failed to decode the input: %s!\n", describeError(result));
+        }
+    }
+
+    if (result == 0)
+    {
+        result = finishDecoderStream(&stream, &output, &output_size);
+        if (result != 0)
+        {
+            fprintf(stderr, "Failed to decode the input: %s!\n", describeError(result));
+        }
+    }
+
+    freeDecoderStream(&stream);
+    return result;
+}
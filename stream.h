@@ -0,0 +1,159 @@
+/*
+ * Data structures, macros and function declarations
+ * used for encoding and decoding incrementally, as the input arrives in chunks.
+ * The stream functions don't print anything (they may be embedded in an event loop whose stdout is data), they only return error codes.
+*/
+
+
+#ifndef STREAM_H
+#define STREAM_H
+
+#include "encode.h"
+#include "decode.h"
+
+// Size of the chunks read from a file descriptor by streamEncodeFile() and streamDecodeFile()
+#define STREAM_CHUNK_SIZE 65536
+// Size of the longest header before the serialized tree: the size of the content, the block type,
+// the number of pairs, the pairs and the size of the tree (BLOCK_TYPE_PAIRS)
+#define MAX_STREAM_HEADER_SIZE (sizeof(long) + sizeof(unsigned char) + 2 * sizeof(unsigned short int) + MAX_PAIR_SYMBOLS * 2)
+
+// Trees of BLOCK_TYPE_HUFFMAN blocks kept for BLOCK_TYPE_REUSE blocks (as many as a codebook cache holds), older ones are freed.
+// An append refers to the latest tree of the file, or to its first block if it has no index, which is kept too.
+#define STREAM_MAX_TREES 64
+
+// The part of a block that the decoder stream is in the middle of
+#define STREAM_STATE_HEADER 0  // reading the header, the bytes are collected until it is complete
+#define STREAM_STATE_TREE 1  // reconstructing the serialized Huffman tree bit by bit
+#define STREAM_STATE_BODY 2  // decoding the Huffman coded content bit by bit
+#define STREAM_STATE_RAW 3  // copying content stored as it is
+#define STREAM_STATE_FAILED 4  // the input is not a valid compressed file, nothing else is decoded
+
+
+// Encodes the chunks fed to it into blocks. A block needs the frequencies of all its characters before its tree can be written,
+// so the input is collected until MAX_BLOCK_SIZE characters are available or the stream is flushed.
+typedef struct encoder_stream
+{
+    encoder_context *context;  // Tables used for encoding every block (set context->cache to share trees with other streams)
+    unsigned char *block;  // Input that is not encoded yet
+    size_t block_size;  // number of characters in block
+    long num_blocks;  // number of blocks written so far
+    int finished;  // set by finishEncoderStream(), nothing can be fed after it
+    FILE *fp_output;  // Collects the output of a call, open only during the call
+    char *output;  // The output of the latest call, valid until the next call
+    size_t output_size;
+} encoder_stream;
+
+// Huffman tree of a BLOCK_TYPE_HUFFMAN block that BLOCK_TYPE_REUSE blocks later in the stream may refer to
+typedef struct stream_tree
+{
+    long offset;  // where the block starts in the stream
+    node *root;
+    struct stream_tree *next;
+} stream_tree;
+
+// Decodes the chunks fed to it as they arrive. The chunks may split a block anywhere, even in the middle of a code,
+// everything needed to continue (the partial header, tree, symbol and byte) is kept here.
+typedef struct decoder_stream
+{
+    int state;  // STREAM_STATE_HEADER, STREAM_STATE_TREE, STREAM_STATE_BODY, STREAM_STATE_RAW or STREAM_STATE_FAILED
+    long stream_offset;  // number of bytes fed so far
+    long block_offset;  // where the current block starts in the stream
+
+    unsigned char header[MAX_STREAM_HEADER_SIZE];  // The header of the current block
+    size_t header_size;  // bytes of the header read so far
+    long decoded_file_size;  // size of the decoded content of the current block
+    unsigned char block_type;
+    unsigned short int num_pairs;
+    unsigned char pairs[MAX_PAIR_SYMBOLS][2];  // the characters of every pair symbol (BLOCK_TYPE_PAIRS)
+
+    int symbol_bits;  // bits of every leaf's symbol in the serialized tree
+    unsigned short int remaining_tree_nodes;  // nodes of the serialized tree not read yet
+    int remaining_symbol_bits;  // bits of the current leaf's symbol not read yet, 0 if not in the middle of a leaf
+    int symbol;  // bits of the current leaf's symbol read so far
+    priority_queue_element *stack;  // The partially reconstructed tree (see ReconstructHuffmanTree())
+
+    node *root;  // The tree of the current block
+    int owns_root;  // root is freed at the end of the block, otherwise it is in trees
+    node *trav;  // The node reached by the bits of the current code
+    long characters_written;  // characters of the current block decoded so far
+    int i_byte;  // The byte whose bits are being read
+    short int remaining_bits;  // bits of i_byte not read yet
+    stream_tree *trees;  // Trees of the latest BLOCK_TYPE_HUFFMAN blocks, the latest first (see STREAM_MAX_TREES)
+
+    FILE *fp_output;  // Collects the output of a call, open only during the call
+    char *output;  // The output of the latest call, valid until the next call
+    size_t output_size;
+} decoder_stream;
+
+
+// Prepare a stream for encoding, pairs of characters are also tried if use_pairs is set.
+// Returns 0 if successful or FAIL_ALLOCATE_MEMORY.
+int initEncoderStream(encoder_stream *stream, int use_pairs);
+
+// Add input_size characters to the stream. *p_output is set to the blocks completed by them (often none), valid until the next call.
+// Returns 0 if successful or one of the error codes in common.h.
+int feedEncoderStream(encoder_stream *stream, const unsigned char *input, size_t input_size, const char **p_output, size_t *p_output_size);
+
+// Encode the characters fed so far into a block even if it is not full, so that the receiver can decode all of them.
+// *p_output is set to the block, valid until the next call. Returns 0 if successful or one of the error codes in common.h.
+int flushEncoderStream(encoder_stream *stream, const char **p_output, size_t *p_output_size);
+
+// Flush the stream and end it. A stream that nothing was fed to ends with an empty block, so that the output is a valid compressed file.
+// *p_output is set to the last blocks, valid until the next call. Returns 0 if successful or one of the error codes in common.h.
+int finishEncoderStream(encoder_stream *stream, const char **p_output, size_t *p_output_size);
+
+// Free the memory used by the stream and its last output
+void freeEncoderStream(encoder_stream *stream);
+
+// Encode the collected characters as a single block into the output of the current call. Returns 0 if successful or one of the error codes in common.h.
+int encodeStreamBlock(encoder_stream *stream);
+
+// Prepare a stream for decoding
+void initDecoderStream(decoder_stream *stream);
+
+// Decode input_size bytes of a compressed file. *p_output is set to every character they complete, valid until the next call.
+// Returns 0 if successful or one of the error codes in common.h.
+int feedDecoderStream(decoder_stream *stream, const unsigned char *input, size_t input_size, const char **p_output, size_t *p_output_size);
+
+// Every character that can be decoded is already handed out by feedDecoderStream(), so the output is always empty.
+// Kept so that the decoder has the same shape as the encoder. Returns 0 if successful or FAIL_READ_BODY if the stream failed before.
+int flushDecoderStream(decoder_stream *stream, const char **p_output, size_t *p_output_size);
+
+// End the stream. *p_output is set to an empty output. Returns 0 if the input ended after a whole block or FAIL_READ_HEADER if it was cut off.
+int finishDecoderStream(decoder_stream *stream, const char **p_output, size_t *p_output_size);
+
+// Free the memory used by the stream, its trees and its last output
+void freeDecoderStream(decoder_stream *stream);
+
+// Free the trees after the latest STREAM_MAX_TREES ones, except the tree of the first block of the stream
+void evictStreamTrees(decoder_stream *stream);
+
+// Returns the number of header bytes needed to know the whole header of the current block (more may be needed once they are read)
+// or -1 if the header is not valid.
+long streamHeaderSize(decoder_stream *stream);
+
+// Read the complete header of the current block and write its content if there is nothing else to read (BLOCK_TYPE_RUN).
+// Returns 0 if successful or one of the error codes in common.h.
+int startStreamBlock(decoder_stream *stream);
+
+// Read a bit of the serialized tree or of the encoded content of the current block. Returns 0 if successful or one of the error codes in common.h.
+int readStreamBit(decoder_stream *stream, char bit);
+
+// Free the tree of the current block unless BLOCK_TYPE_REUSE blocks may refer to it and wait for the header of the next block
+void endStreamBlock(decoder_stream *stream);
+
+// Open the output of the current call and free the output of the previous one. Returns 0 if successful and -1 if unsuccessful.
+int openStreamOutput(FILE **p_fp_output, char **p_output, size_t *p_output_size);
+
+// Close the output of the current call and hand it out. Returns 0 if successful and -1 if unsuccessful.
+int closeStreamOutput(FILE **p_fp_output, char **p_output, size_t *p_output_size, const char **p_result, size_t *p_result_size);
+
+// Encode everything read from in_fd into out_fd, feeding every chunk as soon as it arrives (e.g. from a pipe or a socket).
+// Errors are reported on stderr, out_fd may be stdout. Returns 0 if successful or one of the error codes in common.h.
+int streamEncodeFile(int in_fd, int out_fd, int use_pairs);
+
+// Decode everything read from in_fd into out_fd, writing the characters of every chunk as soon as it arrives.
+// Errors are reported on stderr, out_fd may be stdout. Returns 0 if successful or one of the error codes in common.h.
+int streamDecodeFile(int in_fd, int out_fd);
+
+#endif